@@ -4,7 +4,12 @@
 
 #ifndef __PARSER__CHART_H__
 #define __PARSER__CHART_H__
+
+#include <algorithm>
 #include "boost/shared_ptr.hpp"
+#include "boost/functional/hash.hpp"
+#include "boost/unordered_map.hpp"
+#include "boost/unordered_set.hpp"
 #include "grammar.h"
 
 namespace jhi {
@@ -25,7 +30,7 @@ namespace jhi {
             constituent(int start, int end, std::string head, child_vector_type const& children)
                 : _s(start), _e(end), _h(head), _children(children) {}
 
-            std::string head() const { return _h; }
+            std::string const& head() const { return _h; }
             std::vector<boost::shared_ptr<jhi::constituent> > const& children() const {
                 return _children;
             }
@@ -36,97 +41,847 @@ namespace jhi {
     typedef std::vector<constituent_ptr> constituent_vector;
 
     /**
-     * prints the given constituent tree to the standard output
+     * class constituent_table
+     *
+     * builds constituents by hash-consing: asking for a constituent with the
+     * head, span and children (the same objects) of one built before returns
+     * that one, so identical subtrees are shared however many trees contain
+     * them, and two trees from one table are equal exactly when they are the
+     * same object
+     *
+     * the table keeps its constituents alive until it is cleared
      */
-    inline void print_constituent(constituent_ptr c, std::string indent = "") {
-        if (c->children().empty()) {
-            std::cout << indent << "'" << c->head() << "'" << std::endl;
+    class constituent_table {
+        public:
+            /** a constituent to look up, without building it */
+            struct key {
+                int start;
+                int end;
+                char const* head;
+                constituent_vector const* children;
+            };
+
+        private:
+            struct hasher {
+                std::size_t operator()(key const& k) const;
+                std::size_t operator()(constituent_ptr const& c) const;
+            };
+            struct equal {
+                bool operator()(key const& k, constituent_ptr const& c) const;
+                bool operator()(constituent_ptr const& left, constituent_ptr const& right) const;
+            };
+
+            boost::unordered_set<constituent_ptr, hasher, equal> _table;
+            constituent_vector const _none;
+
+        public:
+            /** a word, or a constituent with no children */
+            constituent_ptr make(int start, int end, char const* head) {
+                return make(start, end, head, _none);
+            }
+            constituent_ptr make(int start, int end, char const* head,
+                    constituent_vector const& children);
+            constituent_ptr make(int start, int end, std::string const& head,
+                    constituent_vector const& children = constituent_vector()) {
+                return make(start, end, head.c_str(), children);
+            }
+
+            /** number of distinct constituents built */
+            std::size_t size() const { return _table.size(); }
+            void clear() { _table.clear(); }
+    };
+
+    /**
+     * prints the given constituent tree to a stream
+     */
+    inline void print_constituent(std::ostream& out, constituent_ptr c, std::string indent = "") {
+        if (c->children().empty() && is_terminal(c->head())) {
+            out << indent << "'" << c->head() << "'" << std::endl;
         } else {
-            std::cout << indent << "(" << c->head() << std::endl;
-            std::for_each(c->children().begin(), c->children().end(),
-                    boost::lambda::bind(print_constituent, boost::lambda::_1, (indent+"    ")));
-            std::cout << indent << ")" << std::endl;
+            out << indent << "(" << c->head() << std::endl;
+            for(int i = 0; i < c->children().size(); ++i)
+                print_constituent(out, c->children()[i], indent + "    ");
+            out << indent << ")" << std::endl;
         }
     }
 
     /**
-     * encapsulates an arc in the parse chart
+     * prints the given constituent tree to the standard output
+     */
+    inline void print_constituent(constituent_ptr c, std::string indent = "") {
+        print_constituent(std::cout, c, indent);
+    }
+
+    /**
+     * an Earley item: a dotted rule and the input position where it was predicted
+     */
+    struct item {
+        int rule;   //index of the rule in the grammar
+        int dot;    //number of right-hand side symbols recognized so far
+        int origin; //index of the chart set where the rule was predicted
+
+        item() : rule(-1), dot(0), origin(0) {}
+        item(int r, int d, int o) : rule(r), dot(d), origin(o) {}
+
+        friend bool operator==(item const& left, item const& right) {
+            return left.rule == right.rule
+                && left.dot == right.dot
+                && left.origin == right.origin;
+        }
+
+        friend std::size_t hash_value(item const& i) {
+            std::size_t seed = 0;
+            boost::hash_combine(seed, i.rule);
+            boost::hash_combine(seed, i.dot);
+            boost::hash_combine(seed, i.origin);
+            return seed;
+        }
+    };
+
+    /**
+     * records one way an item was derived
+     *
+     * the item was made by advancing the dot of item `pred` in set `pred_set`
+     * over either a word (child == -1) or the complete item `child`, which is
+     * in the same set as the derived item
      *
-     * contains a rule to apply, and the constituents currently built
+     * a negative `pred` marks a link over a deterministic reduction path: the
+     * complete item `child` finished symbol leo_symbol(), started in
+     * `pred_set`, and the items between it and this one were skipped (see unfold)
      */
-    class arc {
-            int _s;
-            int _e;
-            jhi::rule _r;
-            int _next;
-            boost::shared_ptr<jhi::constituent> _c;
-            constituent_vector _parts;
+    struct back_pointer {
+        int pred_set;
+        int pred;
+        int child;
+
+        back_pointer(int s, int p, int c) : pred_set(s), pred(p), child(c) {}
+
+        static back_pointer transitive(int set, int symbol, int child) {
+            return back_pointer(set, -symbol - 1, child);
+        }
+        bool leo() const { return pred < 0; }
+        int leo_symbol() const { return -pred - 1; }
+    };
+
+    /**
+     * a memoized deterministic reduction path (Leo)
+     *
+     * when exactly one item of a set waits for a symbol, and the symbol is the
+     * last of its rule, completing the symbol from that set leads to a chain
+     * of complete items with only one possible end: `top`. `pred` is the
+     * index of the waiting item, or -1 if the set has no such path.
+     */
+    struct leo_link {
+        int pred;
+        item top;
+
+        leo_link() : pred(-1) {}
+        leo_link(int p, item const& t) : pred(p), top(t) {}
+    };
+
+    /**
+     * class item_set
+     *
+     * the items of one Earley set, stored as parallel arrays; the symbol each
+     * item waits for is kept alongside, so finding the items waiting for a
+     * symbol is a linear walk over one array that never touches the grammar
+     */
+    class item_set {
+            std::vector<int> _rule;
+            std::vector<int> _dot;
+            std::vector<int> _origin;
+            std::vector<int> _next;
         public:
-            arc(int start, int end, jhi::rule const& r)
-                : _s(start), _e(end), _r(r), _next(0), _c() {}
-            arc(int start, int end, boost::shared_ptr<jhi::constituent> c, jhi::rule const& r)
-                : _s(start), _e(end), _r(r), _next(r.rhs().size()), _c(c) {}
+            int size() const { return _rule.size(); }
+            bool empty() const { return _rule.empty(); }
+            item operator[](int i) const { return item(_rule[i], _dot[i], _origin[i]); }
+            item back() const { return (*this)[size() - 1]; }
 
-            bool complete() const { return _c && _next == _r.rhs().size(); }
+            int rule(int i) const { return _rule[i]; }
+            int dot(int i) const { return _dot[i]; }
+            int origin(int i) const { return _origin[i]; }
 
-            constituent_ptr constituent() const { return _c; }
-            jhi::rule const& rule() const { return _r; }
-            int start() const { return _s; }
-            int end() const { return _e; }
-            std::string next_symbol() const { return complete() ? "" : _r.rhs()[_next]; }
+            /** the symbol after the dot of each item, or -1 if it is complete */
+            int const* next_symbols() const { return _next.empty() ? 0 : &_next[0]; }
+            int next(int i) const { return _next[i]; }
+
+            void push_back(item const& it, int next) {
+                _rule.push_back(it.rule);
+                _dot.push_back(it.dot);
+                _origin.push_back(it.origin);
+                _next.push_back(next);
+            }
+
+            /** remove every item, keeping the storage */
+            void clear() {
+                _rule.clear();
+                _dot.clear();
+                _origin.clear();
+                _next.clear();
+            }
+    };
+
+    /**
+     * class flat_index
+     *
+     * an open-addressing hash map for the chart's per-set indices; clearing
+     * it keeps its slots, and refilling it up to the size it had before
+     * allocates nothing
+     *
+     * slots are marked in use with the current generation, so clearing is
+     * constant time; values are moved when the table grows, so pointers to
+     * them are only good until the next insertion
+     */
+    template <typename Key, typename Value>
+    class flat_index {
+            std::vector<Key> _keys;
+            std::vector<Value> _values;
+            std::vector<unsigned> _used;  //slot generation; current if in use
+            unsigned _generation;
+            int _size;
+
+            std::size_t slot(Key const& k) const {
+                std::size_t h = boost::hash<Key>()(k);
+                h ^= h >> 16;
+                h *= 0x45d9f3bu;
+                h ^= h >> 16;
+                std::size_t mask = _keys.size() - 1;
+                for(h &= mask; _used[h] == _generation && !(_keys[h] == k); h = (h + 1) & mask)
+                    ;
+                return h;
+            }
+
+            void grow() {
+                std::vector<Key> keys(_keys.empty() ? 16 : _keys.size() * 2);
+                std::vector<Value> values(keys.size());
+                std::vector<unsigned> used(keys.size(), 0);
+                keys.swap(_keys);
+                values.swap(_values);
+                used.swap(_used);
+                unsigned old = _generation;
+                _generation = 1;
+                for(int i = 0; i < keys.size(); ++i) {
+                    if (used[i] == old) {
+                        std::size_t s = slot(keys[i]);
+                        _keys[s] = keys[i];
+                        _values[s] = values[i];
+                        _used[s] = _generation;
+                    }
+                }
+            }
+
+        public:
+            flat_index() : _generation(1), _size(0) {}
+
+            int size() const { return _size; }
+
+            /** the value for the key, or 0 */
+            Value const* find(Key const& k) const {
+                if (_size == 0)
+                    return 0;
+                std::size_t s = slot(k);
+                return _used[s] == _generation ? &_values[s] : 0;
+            }
 
             /**
-             * return true if the given arc matches this arc
+             * add the key with the value unless it is present; returns the
+             * key's value and whether it was added
+             */
+            std::pair<Value*, bool> insert(Key const& k, Value const& v) {
+                if (2 * (_size + 1) > _keys.size())
+                    grow();
+                std::size_t s = slot(k);
+                if (_used[s] == _generation)
+                    return std::make_pair(&_values[s], false);
+                _keys[s] = k;
+                _values[s] = v;
+                _used[s] = _generation;
+                ++_size;
+                return std::make_pair(&_values[s], true);
+            }
+
+            /** set the value of the key, adding it if needed */
+            void assign(Key const& k, Value const& v) {
+                std::pair<Value*, bool> r = insert(k, v);
+                if (!r.second)
+                    *r.first = v;
+            }
+
+            void clear() {
+                _size = 0;
+                if (++_generation == 0) {
+                    //wrapped around: old marks could look current
+                    std::fill(_used.begin(), _used.end(), 0u);
+                    _generation = 1;
+                }
+            }
+    };
+
+    /**
+     * class back_pointer_range
+     *
+     * the back pointers of one item, in the order they were added; good only
+     * until the next back pointer is added to the item's set
+     */
+    class back_pointer_range {
+            back_pointer const* _begin;
+            back_pointer const* _end;
+        public:
+            back_pointer_range(back_pointer const* begin, back_pointer const* end)
+                : _begin(begin), _end(end) {}
+
+            int size() const { return _end - _begin; }
+            bool empty() const { return _begin == _end; }
+            back_pointer const& operator[](int b) const { return _begin[b]; }
+            back_pointer const* begin() const { return _begin; }
+            back_pointer const* end() const { return _end; }
+    };
+
+    /**
+     * the Earley chart: one set of items per input position
+     *
+     * each item is stored once per set; alternative derivations of the same item
+     * are kept as additional back pointers, so the chart is a packed parse forest
+     *
+     * the back pointers of a set live in one arena, each item owning a range
+     * of it; a range that is full and not at the end of the arena moves to
+     * the end with twice the room, so adding items and back pointers only
+     * allocates when an arena outgrows its storage
+     */
+    class chart {
+        public:
+            typedef item_set set_type;
+            typedef jhi::back_pointer_range back_pointer_range;
+            typedef std::vector<back_pointer> back_pointer_vector;
+
+        private:
+            typedef flat_index<item, int> index_type;
+            typedef flat_index<int, leo_link> leo_index_type;
+
+            /** where an item's back pointers are in its set's arena */
+            struct bp_slot {
+                int offset;
+                int count;
+                int capacity;
+            };
+
+            jhi::grammar const* _g;
+            int _size;
+            int _items;
+            int _back_pointers;
+            std::size_t _arena_size;    //of every set, counting moved ranges
+            //sets beyond _size, and arenas and slots beyond the size of
+            //their set, are storage kept for reuse
+            std::vector<set_type> _sets;
+            std::vector<back_pointer_vector> _arena;
+            std::vector<std::vector<bp_slot> > _slots;
+            std::vector<index_type> _index;
+            std::vector<leo_index_type> _leo;
+
+            /**
+             * move the item's back pointers to the end of its set's arena,
+             * with room for `capacity`
+             */
+            void move_back_pointers(int set, int i, int capacity) {
+                bp_slot& r = _slots[set][i];
+                back_pointer_vector& arena = _arena[set];
+                int offset = arena.size();
+                arena.resize(offset + capacity, back_pointer(0, 0, 0));
+                for(int b = 0; b < r.count; ++b)
+                    arena[offset + b] = arena[r.offset + b];
+                _arena_size += capacity;
+                r.offset = offset;
+                r.capacity = capacity;
+            }
+
+        public:
+            /** an empty chart, to be reset() before use */
+            chart() : _g(0), _size(0), _items(0), _back_pointers(0), _arena_size(0) {}
+
+            /** the grammar must outlive any addition to the chart */
+            chart(jhi::grammar const& g, int size)
+                : _g(0), _size(0), _items(0), _back_pointers(0), _arena_size(0)
+            {
+                reset(g, size);
+            }
+
+            /**
+             * empty the chart and give it `size` sets for the given grammar,
+             * keeping the storage of the sets, back pointers and indices;
+             * once a chart has held its largest input, resetting and
+             * refilling it allocates nothing
+             */
+            void reset(jhi::grammar const& g, int size) {
+                _g = &g;
+                if (_sets.size() < size) {
+                    _sets.resize(size);
+                    _arena.resize(size);
+                    _slots.resize(size);
+                    _index.resize(size);
+                    _leo.resize(size);
+                }
+                for(int s = 0; s < _size || s < size; ++s) {
+                    _sets[s].clear();
+                    _arena[s].clear();
+                    _index[s].clear();
+                    _leo[s].clear();
+                }
+                _size = size;
+                _items = _back_pointers = 0;
+                _arena_size = 0;
+            }
+
+            /** number of sets (input length + 1) */
+            int size() const { return _size; }
+
+            /** number of items in all sets */
+            int item_count() const { return _items; }
+            int back_pointer_count() const { return _back_pointers; }
+
+            /**
+             * an estimate of the bytes holding the items, back pointers and
+             * item indices, not counting storage kept for reuse
+             */
+            std::size_t bytes() const {
+                std::size_t item_bytes = 4 * sizeof(int) + sizeof(bp_slot)
+                    + 2 * (sizeof(item) + sizeof(int) + sizeof(unsigned)); //index slots
+                return _items * item_bytes + _arena_size * sizeof(back_pointer);
+            }
+            set_type const& operator[](int set) const { return _sets[set]; }
+            back_pointer_range back_pointers(int set, int i) const {
+                bp_slot const& r = _slots[set][i];
+                back_pointer const* begin = r.count ? &_arena[set][r.offset] : 0;
+                return back_pointer_range(begin, begin + r.count);
+            }
+
+            /**
+             * add item to set, returning its index in the set
              *
-             * two arcs match if they apply the same rule over the same span
+             * items already in the set are not duplicated
              */
-            bool matches(boost::shared_ptr<arc> other) {
-                return _s == other->_s
-                    && _e == other->_e
-                    && _r == other->_r
-                    && _next == other->_next
-                    && _c == other->_c;
+            int add(int set, item const& it) {
+                int i = _sets[set].size();
+                std::pair<int*, bool> r = _index[set].insert(it, i);
+                if (r.second) {
+                    ++_items;
+                    _sets[set].push_back(it,
+                            it.dot < _g->length(it.rule) ? _g->rhs(it.rule)[it.dot] : -1);
+                    bp_slot empty = { int(_arena[set].size()), 0, 0 };
+                    if (_slots[set].size() <= i)
+                        _slots[set].push_back(empty);
+                    else
+                        _slots[set][i] = empty;
+                }
+                return *r.first;
             }
 
             /**
-             * create a new arc by extending this arc with the given constituent
+             * add item to set along with the derivation that produced it
+             * (taken by value, as it may be one of the chart's own)
              */
-            boost::shared_ptr<arc> extend(boost::shared_ptr<jhi::constituent> c) {
-                constituent_vector partials(_parts);
-                partials.push_back(c);
-
-                //create new complete arc or partial arc
-                if (partials.size() == _r.rhs().size()) {
-                    return boost::shared_ptr<arc>(
-                        new arc(_s,
-                            c->end(),
-                            constituent_ptr(
-                                new jhi::constituent(_s, c->end(), _r.head(), partials)
-                                ),
-                            _r)
-                    );
+            int add(int set, item const& it, back_pointer bp) {
+                int i = add(set, it);
+                bp_slot& r = _slots[set][i];
+                back_pointer_vector& arena = _arena[set];
+                if (r.count == r.capacity) {
+                    if (r.capacity == 0)
+                        r.offset = arena.size();
+                    else if (r.offset + r.capacity != arena.size())
+                        move_back_pointers(set, i, 2 * r.capacity);
+                }
+                if (r.count == r.capacity) {
+                    //at the end of the arena: grow in place
+                    arena.push_back(bp);
+                    ++_arena_size;
+                    ++r.capacity;
                 } else {
-                    return boost::shared_ptr<arc>(new arc(_s, c->end(), _r, partials));
+                    arena[r.offset + r.count] = bp;
                 }
+                ++r.count;
+                ++_back_pointers;
+                return i;
             }
 
-        private:
-            arc(int start, int end, jhi::rule const& r, constituent_vector const& partials)
-                : _s(start), _e(end), _r(r), _next(partials.size()), _parts(partials) {}
+            void set_back_pointers(int set, int i, back_pointer_vector const& bps) {
+                bp_slot& r = _slots[set][i];
+                if (bps.size() > r.capacity)
+                    move_back_pointers(set, i, bps.size());
+                _back_pointers += bps.size() - r.count;
+                std::copy(bps.begin(), bps.end(), _arena[set].begin() + r.offset);
+                r.count = bps.size();
+            }
+
+            /**
+             * get the memoized reduction path for the symbol in the set,
+             * or 0 if it has not been computed
+             */
+            leo_link const* leo(int set, int symbol) const {
+                return _leo[set].find(symbol);
+            }
+            void set_leo(int set, int symbol, leo_link const& link) {
+                _leo[set].assign(symbol, link);
+            }
+    };
+
+    /**
+     * bounds on the work recognize() does for one sentence; 0 is no bound
+     *
+     * seconds -- wall-clock time
+     * items -- items in the chart
+     * bytes -- memory held by the chart (see chart::bytes)
+     */
+    struct parse_limits {
+        double seconds;
+        int items;
+        std::size_t bytes;
+
+        parse_limits() : seconds(0), items(0), bytes(0) {}
+    };
+
+    /**
+     * how recognition of a sentence ended
+     */
+    enum parse_status {
+        parse_finished,
+        time_exceeded,
+        items_exceeded,
+        memory_exceeded
+    };
+
+    class completion_pool;
+
+    /**
+     * class parser_context
+     *
+     * a chart and the recognizer's working storage, kept from one sentence
+     * to the next: recognize() resets them rather than reallocating, so once
+     * a context has recognized its longest sentence, recognizing more with
+     * one thread allocates nothing; with more threads, the threads are
+     * started once and kept waiting between parallel rounds
+     *
+     * a context may only be used by one thread at a time
+     */
+    class parser_context {
+            typedef std::vector<std::pair<item, back_pointer> > completion_vector;
+
+            jhi::chart _chart;
+            std::vector<int> _words;
+            std::vector<int> _predicted;
+            std::vector<int> _starts;
+            std::vector<int> _stack;
+            std::vector<std::pair<int, int> > _advanced;
+            std::vector<int> _empty;
+            std::vector<leo_link> _leo;
+            std::vector<std::pair<int, int> > _found;
+            std::vector<completion_vector> _completions;
+            boost::shared_ptr<completion_pool> _pool;    //threads of parallel rounds
+            std::vector<std::pair<int, int> > _path;     //reduction paths
+            std::vector<int> _preds;
+            std::vector<int> _goals;                     //unfolding
+            std::vector<std::vector<char> > _seen;
+            std::vector<std::pair<int, int> > _pending;
+            chart::back_pointer_vector _bps;
+            chart::back_pointer_vector _unfolded;
+            parse_limits _limits;
+            parse_status _status;
+            int _finished;
+            int _max_span;
+            std::vector<int> _glue_rules;
+            std::vector<char> _bounded;                  //rules kept to _max_span
+
+            friend chart const& recognize(
+                    parser_context& context,
+                    jhi::grammar const& g,
+                    std::string const& start_symbol,
+                    int const* words,
+                    int length,
+                    bool verbose,
+                    int threads);
+
+        public:
+            parser_context() : _status(parse_finished), _finished(0), _max_span(0) {}
+
+            /** the chart of the last sentence recognized */
+            jhi::chart const& last_chart() const { return _chart; }
+            /** the chart, to unfold items in it (see unfold) */
+            jhi::chart& last_chart() { return _chart; }
+
+            /**
+             * bound the work of each recognize() with the context; a
+             * sentence going over a limit is left unfinished, and its status
+             * tells which limit it went over
+             */
+            void set_limits(parse_limits const& limits) { _limits = limits; }
+            parse_limits const& limits() const { return _limits; }
+
+            /** how recognition of the last sentence ended */
+            parse_status status() const { return _status; }
+
+            /**
+             * number of chart sets of the last sentence that were finished:
+             * all of them, or, if it went over a limit, those for the words
+             * before the one being recognized. the items of finished sets
+             * are every item the grammar derives over those words, and the
+             * parses of the whole input found before stopping are parses
+             */
+            int sets_finished() const { return _finished; }
+
+            /**
+             * keep the constituents of each sentence to at most `length`
+             * words, except those of the start symbol and of the given glue
+             * rules (ids in the grammar being used); 0 is no bound
+             *
+             * items that could only complete into a longer constituent are
+             * never added, so for a fixed bound the work on the bounded rules
+             * grows linearly with the length of the sentence
+             */
+            void set_max_span(int length, std::vector<int> const& glue_rules = std::vector<int>()) {
+                _max_span = length;
+                _glue_rules = glue_rules;
+            }
+            int max_span() const { return _max_span; }
+
+            /**
+             * look up the words of the input in the grammar, -1 standing for
+             * words it does not have; the ids are kept in the context until
+             * its next use
+             *
+             * Word is std::string or token
+             */
+            template <typename Word>
+            int const* word_ids(jhi::grammar const& g, Word const* input, int length) {
+                _words.resize(length);
+                for(int i = 0; i < length; ++i)
+                    _words[i] = g.find(input[i]);
+                return _words.empty() ? 0 : &_words[0];
+            }
     };
 
+    /**
+     * recognize
+     *
+     * runs the Earley recognizer, returning the filled chart
+     *
+     * verbose -- optionally dump state of chart after each step
+     * threads -- number of threads completing items; a set is processed in
+     *     rounds, the completions of a large round being found in parallel
+     *     and then added in order, so the chart does not depend on `threads`
+     */
+    chart recognize(
+            jhi::grammar const& g,
+            std::string const& start_symbol,
+            std::vector<std::string> const& input,
+            bool verbose=false,
+            int threads=1);
+
+    /**
+     * recognize, reusing the context's chart and working storage; the
+     * returned chart is the context's, valid until its next use
+     *
+     * recognition stops early if it goes over the context's limits; see
+     * parser_context::status()
+     */
+    chart const& recognize(
+            parser_context& context,
+            jhi::grammar const& g,
+            std::string const& start_symbol,
+            std::vector<std::string> const& input,
+            bool verbose=false,
+            int threads=1);
+
+    /**
+     * recognize words viewed in the caller's text, without copying them
+     */
+    chart const& recognize(
+            parser_context& context,
+            jhi::grammar const& g,
+            std::string const& start_symbol,
+            token const* input,
+            int length,
+            bool verbose=false,
+            int threads=1);
+
+    /**
+     * recognize words given by their ids in the grammar (see
+     * grammar::find); -1 stands for a word the grammar does not have
+     */
+    chart const& recognize(
+            parser_context& context,
+            jhi::grammar const& g,
+            std::string const& start_symbol,
+            int const* words,
+            int length,
+            bool verbose=false,
+            int threads=1);
+
+    /**
+     * replace the deterministic reduction path links used to derive the given
+     * items, and the items they were derived from, with the items they skipped
+     *
+     * recognize() does this for the parses of the whole input; other items
+     * must be unfolded before their back pointers are followed
+     */
+    void unfold(
+            jhi::grammar const& g,
+            chart& c,
+            int set,
+            std::vector<int> const& items);
+
+    /**
+     * return true if the item has recognized all symbols of its rule
+     */
+    inline bool complete(jhi::grammar const& g, item const& it) {
+        return it.dot == g.length(it.rule);
+    }
+
+    /**
+     * return the indices of the complete start symbol items spanning the whole input
+     */
+    std::vector<int> goal_items(
+            jhi::grammar const& g,
+            std::string const& start_symbol,
+            chart const& c);
+
+    /**
+     * build all parse trees for the input from the chart; the words at the
+     * leaves are the grammar's terminals, so the input is not needed
+     *
+     * the trees share their identical subtrees (see constituent_table)
+     */
+    constituent_vector parse_trees(
+            jhi::grammar const& g,
+            std::string const& start_symbol,
+            chart const& c);
+
+    /**
+     * parse_trees, building the constituents with the given table
+     */
+    constituent_vector parse_trees(
+            jhi::grammar const& g,
+            std::string const& start_symbol,
+            chart const& c,
+            constituent_table& table);
+
+    /**
+     * class parse_enumerator
+     *
+     * produces the parse trees in a chart one at a time, in the order of
+     * parse_trees(), building each only when it is asked for: stopping early
+     * skips the work for the rest, and only the trees the caller keeps stay
+     * in memory, besides the children of the tree being built
+     *
+     * the grammar and chart must outlive the enumerator
+     */
+    class parse_enumerator {
+            struct sequence_cursor;
+            struct tree_cursor;
+            friend struct sequence_cursor;
+            friend struct tree_cursor;
+
+            jhi::grammar const& _g;
+            chart const& _c;
+            constituent_table* _table;
+            int _set;
+            std::vector<int> _goals;
+            int _goal;
+            boost::shared_ptr<tree_cursor> _cursor;
+
+            constituent_ptr make(int start, int end, char const* head, constituent_vector const& children);
+
+            parse_enumerator(parse_enumerator const&);
+            parse_enumerator& operator=(parse_enumerator const&);
+
+        public:
+            parse_enumerator(
+                    jhi::grammar const& g,
+                    std::string const& start_symbol,
+                    chart const& c);
+
+            /**
+             * enumerate the trees building their constituents with the
+             * given table, which then keeps them all alive
+             */
+            parse_enumerator(
+                    jhi::grammar const& g,
+                    std::string const& start_symbol,
+                    chart const& c,
+                    constituent_table& table);
+
+            /**
+             * enumerate the trees for the given complete items of a set,
+             * which must have been unfolded
+             */
+            parse_enumerator(
+                    jhi::grammar const& g,
+                    chart const& c,
+                    int set,
+                    std::vector<int> const& items);
+
+            /**
+             * store the next tree in `tree`; returns false when there are no
+             * more
+             */
+            bool next(constituent_ptr& tree);
+    };
+
+    /**
+     * the first tree parse_trees() would return, building only that one;
+     * returns a null pointer if there is none
+     */
+    constituent_ptr first_parse(
+            jhi::grammar const& g,
+            std::string const& start_symbol,
+            chart const& c);
+
+    /**
+     * cover the input with the fewest fragments when it has no parse: each
+     * fragment is a tree for a complete item already in the chart, or a word
+     * no item covers; of the covers with the fewest fragments, one with the
+     * fewest bare words is chosen
+     *
+     * the cover is found from the chart in one pass over its items, without
+     * parsing again; as the chart only has the items predicted from the start
+     * of the input, the words after the first the grammar cannot continue
+     * with are mostly bare. a chart left unfinished by parse limits is
+     * covered as far as it goes, the rest as bare words. the items of the
+     * fragments are unfolded, so the chart is changed
+     *
+     * returns the fragments in input order, bare words being constituents
+     * with no children headed by the word itself, one for each word not
+     * covered by a tree
+     */
+    constituent_vector fragment_cover(
+            jhi::grammar const& g,
+            chart& c,
+            token const* input,
+            int length);
+
     /**
      * earley
      *
      * runs Earley algorithm using the given grammar and input
      *
      * verbose -- optionally dump state of chart after each step
+     * threads -- number of threads used by recognize()
+     */
+    constituent_vector earley(
+            jhi::grammar const& g,
+            std::string const& start_symbol,
+            std::vector<std::string> const& input,
+            bool verbose=false,
+            int threads=1);
+
+    /**
+     * earley over words viewed in the caller's text, reusing the context
      */
     constituent_vector earley(
+            parser_context& context,
             jhi::grammar const& g,
             std::string const& start_symbol,
-            std::vector<std::string> input,
-            bool verbose=false);
+            token const* input,
+            int length,
+            bool verbose=false,
+            int threads=1);
 
 }//namespace jhi
 
@@ -0,0 +1,292 @@
+//      Copyright Joseph Irwin <joseph.irwin.gt@gmail.com>
+// Distributed under the Boost Software License, Version 1.0.
+//            http://www.boost.org/LICENSE_1_0.txt
+
+#include "cky.h"
+
+#include <sstream>
+#include <stdexcept>
+#include "boost/thread.hpp"
+#include "boost/thread/barrier.hpp"
+
+namespace {
+
+    inline int lowest_bit(jhi::label_word w) {
+#ifdef __GNUC__
+        return __builtin_ctzll(w);
+#else
+        int b = 0;
+        while (!(w & 1)) { w >>= 1; ++b; }
+        return b;
+#endif
+    }
+
+    inline int bit_count(jhi::label_word w) {
+#ifdef __GNUC__
+        return __builtin_popcountll(w);
+#else
+        int n = 0;
+        for( ; w; w &= w - 1) ++n;
+        return n;
+#endif
+    }
+
+    inline void set_bit(jhi::label_word* mask, int label) {
+        mask[label / 64] |= jhi::label_word(1) << (label % 64);
+    }
+
+    void not_binarized(jhi::grammar const& g, int r) {
+        std::ostringstream msg;
+        msg << "cky: not a binarized rule: ";
+        g.write_rule(msg, r);
+        throw std::runtime_error(msg.str());
+    }
+
+    /**
+     * fill the cells of span length `len` starting at [first, last)
+     */
+    void fill_cells(jhi::cky_grammar const& cg, jhi::cky_chart& c, int len, int first, int last) {
+        for(int i = first; i < last; ++i) {
+            int j = i + len;
+            jhi::label_word* out = c.cell(i, j);
+            for(int k = i + 1; k < j; ++k)
+                cg.combine(c.cell(i, k), c.cell(k, j), out);
+            cg.close(out);
+        }
+    }
+
+    /**
+     * fills its share of each diagonal of the chart, shortest spans first;
+     * the cells of a diagonal only read shorter spans, so workers wait for
+     * each other only between diagonals
+     */
+    struct cky_worker {
+        jhi::cky_grammar const* cg;
+        jhi::cky_chart* c;
+        boost::barrier* diagonal_done;
+        int worker;
+        int workers;
+
+        void operator()() const {
+            int n = c->size();
+            for(int len = 2; len <= n; ++len) {
+                int cells = n - len + 1;
+                fill_cells(*cg, *c, len,
+                        cells * worker / workers, cells * (worker + 1) / workers);
+                diagonal_done->wait();
+            }
+        }
+    };
+
+}//namespace
+
+namespace jhi {
+
+    cky_grammar::cky_grammar(grammar const& g)
+        : _labels(0), _label(g.symbol_count(), -1), _lexical(g.symbol_count(), -1)
+    {
+        for(int s = 0; s < g.symbol_count(); ++s) {
+            if (!g.terminal(s)) {
+                _label[s] = _labels++;
+                _symbol.push_back(s);
+            }
+        }
+        _words = (_labels + 63) / 64;
+        int w = _words;
+
+        //sort the rules by shape, checking they are binarized
+        std::vector<std::pair<std::pair<int, int>, int> > binary; //((left, right), head)
+        std::vector<int> lexical;
+        _unary.assign(std::size_t(_labels) * w, 0);
+        for(int a = 0; a < _labels; ++a)
+            set_bit(&_unary[a * w], a);
+        for(int r = 0; r < g.size(); ++r) {
+            id_range rhs = g.rhs(r);
+            int head = _label[g.head(r)];
+            if (rhs.size() == 1 && g.terminal(rhs[0])) {
+                lexical.push_back(r);
+            } else if (rhs.size() == 1) {
+                set_bit(&_unary[_label[rhs[0]] * w], head);
+            } else if (rhs.size() == 2 && !g.terminal(rhs[0]) && !g.terminal(rhs[1])) {
+                binary.push_back(std::make_pair(
+                            std::make_pair(_label[rhs[0]], _label[rhs[1]]), head));
+            } else {
+                not_binarized(g, r);
+            }
+        }
+
+        //transitive closure of the unary rules: merge the set of each label
+        //reachable upward into the sets that reach it, until nothing changes
+        for(bool changed = true; changed; ) {
+            changed = false;
+            for(int a = 0; a < _labels; ++a) {
+                label_word* up = &_unary[a * w];
+                for(int k = 0; k < w; ++k) {
+                    for(label_word bits = up[k]; bits; bits &= bits - 1) {
+                        int b = k * 64 + lowest_bit(bits);
+                        label_word const* further = &_unary[b * w];
+                        for(int x = 0; x < w; ++x) {
+                            if (further[x] & ~up[x]) {
+                                up[x] |= further[x];
+                                changed = true;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+
+        //lexical masks, closed under unary rules
+        for(int i = 0; i < lexical.size(); ++i) {
+            int word = g.rhs(lexical[i])[0];
+            if (_lexical[word] < 0) {
+                _lexical[word] = _lexical_masks.size() / w;
+                _lexical_masks.resize(_lexical_masks.size() + w, 0);
+            }
+            set_bit(&_lexical_masks[_lexical[word] * w], _label[g.head(lexical[i])]);
+        }
+        for(int i = 0; i < _lexical_masks.size(); i += w)
+            close(&_lexical_masks[i]);
+
+        //binary rules grouped by left child, then right child
+        std::sort(binary.begin(), binary.end());
+        _right.assign(std::size_t(_labels) * w, 0);
+        std::vector<label_word> pair_heads;
+        std::vector<int> first_pair(_labels + 1, 0);
+        for(int i = 0; i < binary.size(); ) {
+            int left = binary[i].first.first, right = binary[i].first.second;
+            set_bit(&_right[left * w], right);
+            pair_heads.resize(pair_heads.size() + w, 0);
+            for( ; i < binary.size() && binary[i].first == std::make_pair(left, right); ++i)
+                set_bit(&pair_heads[pair_heads.size() - w], binary[i].second);
+            ++first_pair[left + 1];
+        }
+        for(int a = 0; a < _labels; ++a)
+            first_pair[a + 1] += first_pair[a];
+
+        //the index of each subset of a nibble's set bits among that
+        //nibble's non-empty subsets, counting from 1
+        _subset.assign(16 * 16, 0);
+        for(int nib = 0; nib < 16; ++nib) {
+            for(int v = 0; v < 16; ++v) {
+                if (v & ~nib) continue;
+                int index = 0, bit = 0;
+                for(int i = 0; i < 4; ++i) {
+                    if (!(nib >> i & 1)) continue;
+                    if (v >> i & 1) index |= 1 << bit;
+                    ++bit;
+                }
+                _subset[nib * 16 + v] = index;
+            }
+        }
+
+        //for each nibble of a left child's right children, the heads of every
+        //non-empty subset of those right children; a subset's heads are those
+        //of the subset without its lowest child, plus that child's own
+        _nibbles.assign(std::size_t(_labels) * w, -1);
+        for(int a = 0; a < _labels; ++a) {
+            int pair = first_pair[a];
+            for(int x = 0; x < w; ++x) {
+                label_word children = _right[a * w + x];
+                if (!children) continue;
+                _nibbles[a * w + x] = _nibble_tables.size();
+                _nibble_tables.resize(_nibble_tables.size() + 16, -1);
+                for(int q = 0; q < 16; ++q) {
+                    int nib = int(children >> (4 * q)) & 15;
+                    if (!nib) continue;
+                    int table = _heads.size() / w;
+                    int subsets = (1 << bit_count(nib)) - 1;
+                    _nibble_tables[_nibbles[a * w + x] + q] = table;
+                    _heads.resize(_heads.size() + std::size_t(subsets) * w, 0);
+                    for(int v = 1; v <= subsets; ++v) {
+                        label_word* h = &_heads[(std::size_t(table) + v - 1) * w];
+                        label_word const* own = &pair_heads[std::size_t(pair + lowest_bit(v)) * w];
+                        label_word const* rest = (v & (v - 1))
+                            ? &_heads[(std::size_t(table) + (v & (v - 1)) - 1) * w] : 0;
+                        for(int y = 0; y < w; ++y)
+                            h[y] = own[y] | (rest ? rest[y] : 0);
+                    }
+                    pair += bit_count(nib);
+                }
+            }
+        }
+    }
+
+    void cky_grammar::combine(label_word const* left, label_word const* right, label_word* out) const {
+        int w = _words;
+        for(int k = 0; k < w; ++k) {
+            for(label_word bits = left[k]; bits; bits &= bits - 1) {
+                int b = k * 64 + lowest_bit(bits);
+                label_word const* children = &_right[b * w];
+                for(int x = 0; x < w; ++x) {
+                    label_word c = right[x] & children[x];
+                    if (!c) continue;
+                    //one OR per nibble of matching right children
+                    int const* tables = &_nibble_tables[_nibbles[b * w + x]];
+                    do {
+                        int shift = lowest_bit(c) & ~3;
+                        int nib = int(children[x] >> shift) & 15;
+                        int v = int(c >> shift) & 15;
+                        label_word const* h =
+                            &_heads[(std::size_t(tables[shift / 4]) + _subset[nib * 16 + v] - 1) * w];
+                        for(int y = 0; y < w; ++y)
+                            out[y] |= h[y];
+                        c &= ~(label_word(15) << shift);
+                    } while (c);
+                }
+            }
+        }
+    }
+
+    void cky_grammar::close(label_word* cell) const {
+        //the unary table is transitive, so labels added here need no
+        //further closing (visiting them again is harmless)
+        int w = _words;
+        for(int k = 0; k < w; ++k) {
+            for(label_word bits = cell[k]; bits; bits &= bits - 1) {
+                label_word const* up = &_unary[(k * 64 + lowest_bit(bits)) * w];
+                for(int x = 0; x < w; ++x)
+                    cell[x] |= up[x];
+            }
+        }
+    }
+
+    cky_chart cky_recognize(
+            jhi::grammar const& g,
+            cky_grammar const& cg,
+            std::vector<std::string> const& input,
+            int threads)
+    {
+        int n = input.size();
+        cky_chart c(n, cg.words());
+        for(int i = 0; i < n; ++i) {
+            label_word const* lex = cg.lexical(g.find(input[i]));
+            if (lex)
+                std::copy(lex, lex + cg.words(), c.cell(i, i + 1));
+        }
+        threads = std::min(threads, n - 1);
+        if (threads <= 1) {
+            for(int len = 2; len <= n; ++len)
+                fill_cells(cg, c, len, 0, n - len + 1);
+        } else {
+            boost::barrier diagonal_done(threads);
+            boost::thread_group group;
+            for(int t = 0; t < threads; ++t) {
+                cky_worker w = { &cg, &c, &diagonal_done, t, threads };
+                group.create_thread(w);
+            }
+            group.join_all();
+        }
+        return c;
+    }
+
+    bool accepted(
+            jhi::grammar const& g,
+            cky_grammar const& cg,
+            std::string const& start_symbol,
+            cky_chart const& c)
+    {
+        return c.size() > 0 && c.contains(0, c.size(), cg.label(g.find(start_symbol)));
+    }
+
+}//namespace jhi
@@ -0,0 +1,140 @@
+//      Copyright Joseph Irwin <joseph.irwin.gt@gmail.com>
+// Distributed under the Boost Software License, Version 1.0.
+//            http://www.boost.org/LICENSE_1_0.txt
+
+#ifndef __PARSER__CKY_H__
+#define __PARSER__CKY_H__
+
+#include "grammar.h"
+
+namespace jhi {
+
+    /**
+     * a set of labels packed 64 to a word
+     */
+    typedef boost::uint64_t label_word;
+
+    /**
+     * class cky_grammar
+     *
+     * a binarized grammar compiled for the bit-parallel CKY recognizer:
+     * non-terminals are numbered densely as labels, and each rule table is a
+     * label mask, so combining two cells is a run of word-wide ANDs and ORs
+     *
+     * the heads of binary rules are precomputed for every subset of each
+     * group of four right children (a Four-Russians table), so one OR adds
+     * the heads of up to four (left, right) pairs
+     *
+     * the grammar may only have binary rules over non-terminals ($a --> $b $c),
+     * unary rules ($a --> $b, closed transitively) and lexical rules
+     * ($a --> word); the constructor throws std::runtime_error otherwise
+     */
+    class cky_grammar {
+            int _labels;
+            int _words;                          //label_words per mask
+            std::vector<int> _label;             //symbol -> label, or -1
+            std::vector<int> _symbol;            //label -> symbol
+            std::vector<int> _lexical;           //terminal symbol -> mask index, or -1
+            std::vector<label_word> _lexical_masks;
+            std::vector<label_word> _unary;      //label -> labels deriving it by unary rules
+            std::vector<label_word> _right;      //left child -> possible right children
+            std::vector<int> _nibbles;           //left child, word -> first of its 16 nibble tables
+            std::vector<int> _nibble_tables;     //nibble -> first subset mask in _heads
+            std::vector<label_word> _heads;      //nibble table, subset of its right children -> heads
+            std::vector<unsigned char> _subset;  //nibble, right children in it -> subset index
+
+        public:
+            explicit cky_grammar(grammar const& g);
+
+            /** number of labels (non-terminals) */
+            int labels() const { return _labels; }
+
+            /** number of words in a label mask */
+            int words() const { return _words; }
+
+            /** label of a non-terminal symbol, or -1 */
+            int label(int symbol) const {
+                return symbol < 0 || symbol >= _label.size() ? -1 : _label[symbol];
+            }
+
+            /** symbol of a label */
+            int symbol(int label) const { return _symbol[label]; }
+
+            /**
+             * labels deriving the given terminal, closed under unary rules;
+             * 0 if no rule derives it
+             */
+            label_word const* lexical(int symbol) const {
+                return symbol < 0 || symbol >= _lexical.size() || _lexical[symbol] < 0
+                    ? 0 : &_lexical_masks[_lexical[symbol] * _words];
+            }
+
+            /**
+             * add to `out` the labels that can head a constituent made of a
+             * constituent with a label in `left` followed by one with a label
+             * in `right` (before unary rules)
+             */
+            void combine(label_word const* left, label_word const* right, label_word* out) const;
+
+            /** replace the labels in `cell` with their closure under unary rules */
+            void close(label_word* cell) const;
+    };
+
+    /**
+     * class cky_chart
+     *
+     * the label sets of every span of a sentence, stored in one block
+     */
+    class cky_chart {
+            int _n;
+            int _words;
+            std::vector<label_word> _cells;
+        public:
+            cky_chart(int n, int words)
+                : _n(n), _words(words), _cells(std::size_t(n) * (n + 1) / 2 * words, 0) {}
+
+            /** number of words in the sentence */
+            int size() const { return _n; }
+
+            /** the labels spanning words [i, j) */
+            label_word* cell(int i, int j) {
+                return &_cells[(std::size_t(j - i - 1) * (2 * _n - j + i + 2) / 2 + i) * _words];
+            }
+            label_word const* cell(int i, int j) const {
+                return &_cells[(std::size_t(j - i - 1) * (2 * _n - j + i + 2) / 2 + i) * _words];
+            }
+
+            /** true if a constituent with the label spans words [i, j) */
+            bool contains(int i, int j, int label) const {
+                return label >= 0 && (cell(i, j)[label / 64] >> (label % 64) & 1);
+            }
+    };
+
+    /**
+     * cky_recognize
+     *
+     * fills a chart bottom-up with every label that can span each part of
+     * the input
+     *
+     * threads -- number of threads filling the chart; the cells of each span
+     *     length are split between them, one diagonal at a time
+     */
+    cky_chart cky_recognize(
+            jhi::grammar const& g,
+            cky_grammar const& cg,
+            std::vector<std::string> const& input,
+            int threads = 1);
+
+    /**
+     * return true if the chart has the start symbol spanning the whole input
+     * (the empty input is never accepted)
+     */
+    bool accepted(
+            jhi::grammar const& g,
+            cky_grammar const& cg,
+            std::string const& start_symbol,
+            cky_chart const& c);
+
+}//namespace jhi
+
+#endif //__PARSER__CKY_H__
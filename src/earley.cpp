@@ -4,124 +4,1110 @@
 
 #include "chart.h"
 
-namespace {
+#include <algorithm>
+#include <cstring>
+
+#include "boost/date_time/posix_time/posix_time_types.hpp"
+#include "boost/thread.hpp"
 
-    typedef boost::shared_ptr<jhi::arc> arc_ptr;
-    typedef std::vector<arc_ptr> chart_cell_type;
-    typedef std::vector<chart_cell_type> chart_type;
+namespace {
 
     /**
      * pretty print the chart
      */
-    void print_chart(chart_type &chart) {
+    void print_chart(jhi::grammar const& g, jhi::chart const& chart) {
         std::cout << "Chart:\n";
         for(int i = 0; i < chart.size(); ++i) {
             std::cout << "Cell: ";
             for(int j = 0; j < chart[i].size(); ++j) {
-                std::cout << "[ "
-                          << chart[i][j]->rule()
-                          << " ("
-                          << chart[i][j]->next_symbol()
+                jhi::item const& it = chart[i][j];
+                std::cout << "[ ";
+                g.write_rule(std::cout, it.rule);
+                std::cout << " ("
+                          << (jhi::complete(g, it) ? "" : g.name(g.rhs(it.rule)[it.dot]))
                           << ") ("
-                          << chart[i][j]->start()
+                          << it.origin
                           << " "
-                          << chart[i][j]->end()
+                          << i
                           << ") "
-                          << (chart[i][j]->complete() ? "c" : "i")
+                          << (jhi::complete(g, it) ? "c" : "i")
                           << "] ";
             }
             std::cout << "\n";
         }
     }
 
+    typedef std::vector<jhi::constituent_vector> sequence_vector;
+
+    /**
+     * a constituent being built: its head symbol and span
+     */
+    struct open_constituent {
+        int symbol;
+        int start;
+        int end;
+
+        open_constituent(int h, int s, int e) : symbol(h), start(s), end(e) {}
+
+        friend bool operator==(open_constituent const& left, open_constituent const& right) {
+            return left.symbol == right.symbol && left.start == right.start && left.end == right.end;
+        }
+    };
+
+    typedef std::vector<open_constituent> open_vector;
+
+    jhi::constituent_vector trees_for(
+            jhi::grammar const& g,
+            jhi::chart const& chart,
+            int set, int i,
+            open_vector& open,
+            jhi::constituent_table& table);
+
+    /**
+     * build every sequence of children for the recognized part of an item
+     */
+    sequence_vector children_for(
+            jhi::grammar const& g,
+            jhi::chart const& chart,
+            int set, int i,
+            open_vector& open,
+            jhi::constituent_table& table)
+    {
+        sequence_vector ret;
+        if (chart[set][i].dot == 0) {
+            ret.push_back(jhi::constituent_vector());
+            return ret;
+        }
+
+        jhi::chart::back_pointer_range bps = chart.back_pointers(set, i);
+        for(int b = 0; b < bps.size(); ++b) {
+            jhi::back_pointer const& bp = bps[b];
+            jhi::constituent_vector last;
+            if (bp.child < 0) {
+                //child is the word itself, the symbol the predecessor waited for
+                last.push_back(table.make(bp.pred_set, set, g.name(chart[bp.pred_set].next(bp.pred))));
+            } else {
+                last = trees_for(g, chart, set, bp.child, open, table);
+                if (last.empty())
+                    continue;
+            }
+
+            sequence_vector prefixes(children_for(g, chart, bp.pred_set, bp.pred, open, table));
+
+            for(int p = 0; p < prefixes.size(); ++p) {
+                for(int l = 0; l < last.size(); ++l) {
+                    ret.push_back(prefixes[p]);
+                    ret.back().push_back(last[l]);
+                }
+            }
+        }
+        return ret;
+    }
+
+    /**
+     * build every tree for a complete item
+     *
+     * a unary cycle lets a constituent contain itself, giving infinitely many
+     * trees; derivations where a constituent is nested in one with the same
+     * head and span are cut, so each tree and the number of trees are finite
+     */
+    jhi::constituent_vector trees_for(
+            jhi::grammar const& g,
+            jhi::chart const& chart,
+            int set, int i,
+            open_vector& open,
+            jhi::constituent_table& table)
+    {
+        jhi::item const& it = chart[set][i];
+        open_constituent self(g.head(it.rule), it.origin, set);
+        if (std::find(open.begin(), open.end(), self) != open.end())
+            return jhi::constituent_vector();
+        open.push_back(self);
+        sequence_vector children(children_for(g, chart, set, i, open, table));
+        open.pop_back();
+
+        jhi::constituent_vector ret;
+        for(int k = 0; k < children.size(); ++k)
+            ret.push_back(table.make(it.origin, set, g.name(g.head(it.rule)), children[k]));
+        return ret;
+    }
+
+    /**
+     * true if an item in a set keeps within the span bound; `bounded` marks
+     * the rules kept to `max_span` words, and is empty if there is no bound
+     */
+    inline bool within_span(std::vector<char> const& bounded, int max_span, jhi::item const& it, int set) {
+        return bounded.empty() || !bounded[it.rule] || set - it.origin <= max_span;
+    }
+
+    /**
+     * find the deterministic reduction path for completing `symbol` from `set`
+     * (Leo), memoizing it and the paths above it; returns 0 if completing the
+     * symbol from the set could advance more than one item, or none
+     *
+     * paths only go through rules free of the span bound (see within_span),
+     * as a path is shared by items ending anywhere
+     *
+     * `path` and `preds` are working storage
+     */
+    jhi::leo_link const* transitive(
+            jhi::grammar const& g,
+            jhi::chart& c,
+            int set, int symbol,
+            std::vector<char> const& bounded,
+            std::vector<std::pair<int, int> >& path, //(set, symbol)
+            std::vector<int>& preds)
+    {
+        //walk up the path until reaching a memoized link or a set where
+        //completion is not deterministic
+        path.clear();
+        preds.clear();
+        jhi::leo_link const* known = 0;
+        int s = set, b = symbol;
+        while (!(known = c.leo(s, b))) {
+            int found = -1;
+            bool unique = true;
+            int const* next = c[s].next_symbols();
+            for(int k = 0; k < c[s].size() && unique; ++k) {
+                if (next[k] == b) {
+                    unique = found < 0;
+                    found = k;
+                }
+            }
+            bool cycle = false;
+            for(int k = path.size() - 1; k >= 0 && path[k].first == s && !cycle; --k)
+                cycle = path[k].second == b;
+            if (cycle) {
+                //a path through empty constituents back to itself: no shortcut
+                for(int k = 0; k < path.size(); ++k)
+                    c.set_leo(path[k].first, path[k].second, jhi::leo_link(-1, jhi::item(-1, 0, 0)));
+                return 0;
+            }
+            if (!unique || found < 0 || c[s][found].dot + 1 != g.length(c[s][found].rule)
+                    || (!bounded.empty() && bounded[c[s][found].rule])) {
+                c.set_leo(s, b, jhi::leo_link(-1, jhi::item(-1, 0, 0)));
+                known = c.leo(s, b);
+                break;
+            }
+            path.push_back(std::make_pair(s, b));
+            preds.push_back(found);
+            jhi::item const& p = c[s][found];
+            s = p.origin;
+            b = g.head(p.rule);
+        }
+
+        //every link on the path leads to the same top item
+        for(int k = path.size() - 1; k >= 0; --k) {
+            jhi::item const& p = c[path[k].first][preds[k]];
+            jhi::item top = known->pred >= 0 ? known->top
+                : jhi::item(p.rule, p.dot + 1, p.origin);
+            c.set_leo(path[k].first, path[k].second, jhi::leo_link(preds[k], top));
+            known = c.leo(path[k].first, path[k].second);
+        }
+        return known->pred >= 0 ? known : 0;
+    }
+
+    /**
+     * replace the reduction path links of one item with the complete items
+     * along each path, adding those to the item's set
+     *
+     * `bps` and `out` are working storage
+     */
+    void unfold_item(
+            jhi::grammar const& g,
+            jhi::chart& c,
+            int i, int t,
+            jhi::chart::back_pointer_vector& bps,
+            jhi::chart::back_pointer_vector& out)
+    {
+        bool changed = false;
+        for(int b = 0; b < c.back_pointers(i, t).size() && !changed; ++b)
+            changed = c.back_pointers(i, t)[b].leo();
+        if (!changed)
+            return;
+        bps.assign(c.back_pointers(i, t).begin(), c.back_pointers(i, t).end());
+        out.clear();
+        for(int b = 0; b < bps.size(); ++b) {
+            if (!bps[b].leo()) {
+                out.push_back(bps[b]);
+                continue;
+            }
+            int j = bps[b].pred_set, symbol = bps[b].leo_symbol(), child = bps[b].child;
+            while (true) {
+                int pred = c.leo(j, symbol)->pred;
+                jhi::item const p = c[j][pred];
+                jhi::leo_link const* up = c.leo(p.origin, g.head(p.rule));
+                if (!up || up->pred < 0) {
+                    //reached the top item itself
+                    out.push_back(jhi::back_pointer(j, pred, child));
+                    break;
+                }
+                int before = c[i].size();
+                int k = c.add(i, jhi::item(p.rule, p.dot + 1, p.origin),
+                        jhi::back_pointer(j, pred, child));
+                if (k < before)
+                    break; //the rest of the path was unfolded before
+                child = k;
+                j = p.origin;
+                symbol = g.head(p.rule);
+            }
+        }
+        c.set_back_pointers(i, t, out);
+    }
+
+    /**
+     * unfold() with its working storage: `seen` marks the items visited, and
+     * `stack` holds those still to visit
+     */
+    void unfold_items(
+            jhi::grammar const& g,
+            jhi::chart& c,
+            int set,
+            std::vector<int> const& items,
+            std::vector<std::vector<char> >& seen,
+            std::vector<std::pair<int, int> >& stack,
+            jhi::chart::back_pointer_vector& bps,
+            jhi::chart::back_pointer_vector& out)
+    {
+        if (seen.size() < c.size())
+            seen.resize(c.size());
+        for(int s = 0; s < c.size(); ++s)
+            seen[s].clear();
+        stack.clear();
+        for(int k = 0; k < items.size(); ++k)
+            stack.push_back(std::make_pair(set, items[k]));
+        while (!stack.empty()) {
+            int s = stack.back().first, i = stack.back().second;
+            stack.pop_back();
+            if (seen[s].size() <= i)
+                seen[s].resize(c[s].size(), 0);
+            if (seen[s][i])
+                continue;
+            seen[s][i] = 1;
+
+            unfold_item(g, c, s, i, bps, out);
+            for(int b = 0; b < c.back_pointers(s, i).size(); ++b) {
+                jhi::back_pointer bp = c.back_pointers(s, i)[b];
+                stack.push_back(std::make_pair(bp.pred_set, bp.pred));
+                if (bp.child >= 0)
+                    stack.push_back(std::make_pair(s, bp.child));
+            }
+        }
+    }
+
+    /**
+     * store in `goals` the indices of the complete start symbol items
+     * spanning the whole input
+     */
+    void find_goals(
+            jhi::grammar const& g,
+            int start,
+            jhi::chart const& c,
+            std::vector<int>& goals)
+    {
+        goals.clear();
+        jhi::chart::set_type const& last = c[c.size() - 1];
+        for(int i = 0; i < last.size(); ++i)
+            if (last.origin(i) == 0 && last.next(i) < 0 && g.head(last.rule(i)) == start)
+                goals.push_back(i);
+    }
+
+    /**
+     * mark the symbols that can start with the word at `set` (the word itself
+     * and every non-terminal with it as a left corner) by setting their entry
+     * of `starts` to `set`
+     */
+    void mark_left_corners(
+            jhi::grammar const& g,
+            std::vector<int>& starts,
+            std::vector<int>& stack,
+            int set, int word)
+    {
+        if (word < 0)
+            return;
+        starts[word] = set;
+        stack.assign(1, word);
+        while (!stack.empty()) {
+            jhi::id_range parents = g.left_corner_parents(stack.back());
+            stack.pop_back();
+            for(int i = 0; i < parents.size(); ++i) {
+                if (starts[parents[i]] != set) {
+                    starts[parents[i]] = set;
+                    stack.push_back(parents[i]);
+                }
+            }
+        }
+    }
+
     /**
-     * add arc to chart
+     * true if the rule can derive the empty string or a string starting with
+     * the word marked in `starts` for the set
+     */
+    bool viable(jhi::grammar const& g, std::vector<int> const& starts, int set, int r) {
+        jhi::id_range rhs = g.rhs(r);
+        for(int d = 0; d < rhs.size(); ++d) {
+            if (starts[rhs[d]] == set)
+                return true;
+            if (!g.nullable(rhs[d]))
+                return false;
+        }
+        return true;
+    }
+
+    /**
+     * add items for the rules that can start the given symbol, skipping rules
+     * that cannot start with the next word (see mark_left_corners)
      *
-     * adds arc only if the new arc doesn't match any arc already in the chart
+     * `predicted` records the last set each non-terminal was predicted in,
+     * so each is predicted at most once per set
      */
-    void add_to_chart(chart_type &chart, arc_ptr arc) {
-        for(int k = 0; k < chart[arc->end()].size(); ++k)
-            if (arc->matches(chart[arc->end()][k]))
-                return;
-        chart[arc->end()].push_back(arc);
+    void predict(
+            jhi::grammar const& g,
+            jhi::chart& chart,
+            std::vector<int>& predicted,
+            std::vector<int> const& starts,
+            int set, int symbol)
+    {
+        if (predicted[symbol] == set)
+            return;
+        jhi::id_range closure = g.closure(symbol);
+        for(int i = 0; i < closure.size(); ++i) {
+            if (predicted[closure[i]] == set)
+                continue;
+            predicted[closure[i]] = set;
+            if (starts[closure[i]] != set && !g.nullable(closure[i]))
+                continue;
+            jhi::id_range rules = g.rules_for(closure[i]);
+            for(int k = 0; k < rules.size(); ++k)
+                if (viable(g, starts, set, rules[k]))
+                    chart.add(set, jhi::item(rules[k], 0, set));
+        }
     }
+
+    /**
+     * rounds of a set with fewer items than this are completed by one thread
+     */
+    int const parallel_round = 256;
+
+    typedef std::vector<std::pair<jhi::item, jhi::back_pointer> > completion_vector;
+
+    /**
+     * the clock is read once per this many items processed
+     */
+    int const clock_period = 256;
+
+    /**
+     * checks the chart of one sentence against the limits of its context
+     */
+    struct limit_checker {
+        jhi::parse_limits limits;
+        bool on; //any limit is set
+        boost::posix_time::ptime deadline;
+        int countdown;
+
+        limit_checker(jhi::parse_limits const& l)
+            : limits(l), on(l.seconds > 0 || l.items > 0 || l.bytes > 0), countdown(0)
+        {
+            if (l.seconds > 0)
+                deadline = boost::posix_time::microsec_clock::universal_time()
+                    + boost::posix_time::microseconds(boost::int64_t(l.seconds * 1e6));
+        }
+
+        jhi::parse_status check(jhi::chart const& c) {
+            if (limits.items > 0 && c.item_count() > limits.items)
+                return jhi::items_exceeded;
+            if (limits.bytes > 0 && c.bytes() > limits.bytes)
+                return jhi::memory_exceeded;
+            if (limits.seconds > 0 && --countdown < 0) {
+                countdown = clock_period;
+                if (boost::posix_time::microsec_clock::universal_time() >= deadline)
+                    return jhi::time_exceeded;
+            }
+            return jhi::parse_finished;
+        }
+    };
+
+    /**
+     * finds the items extended by the complete items of part of a round,
+     * without changing the chart
+     *
+     * `found[k]` receives the range of `out` holding the completions of the
+     * k-th item of the round; items completed through a reduction path
+     * (`leo[k].pred` set) or with an empty span get none
+     */
+    struct completion_worker {
+        jhi::grammar const* g;
+        jhi::chart const* c;
+        int set;
+        int round;  //first item of the round
+        int first;  //part of the round for this worker
+        int last;
+        std::vector<jhi::leo_link> const* leo;
+        std::vector<std::pair<int, int> >* found;
+        completion_vector* out;
+
+        void operator()() const {
+            for(int j = first; j < last; ++j) {
+                jhi::item const& a = (*c)[set][j];
+                int begin = out->size();
+                if (jhi::complete(*g, a) && a.origin < set && (*leo)[j - round].pred < 0) {
+                    int head = g->head(a.rule);
+                    jhi::item_set const& waiting = (*c)[a.origin];
+                    int const* next = waiting.next_symbols();
+                    for(int k = 0; k < waiting.size(); ++k)
+                        if (next[k] == head)
+                            out->push_back(std::make_pair(
+                                        jhi::item(waiting.rule(k), waiting.dot(k) + 1, waiting.origin(k)),
+                                        jhi::back_pointer(a.origin, k, j)));
+                }
+                (*found)[j - round] = std::make_pair(begin, (int)out->size());
+            }
+        }
+    };
 }
 
 namespace jhi {
+
     /**
-     * earley
+     * class completion_pool
      *
-     * runs Earley algorithm using the given grammar and input
+     * the threads finding the completions of a context's parallel rounds,
+     * started by its first parallel round and waiting between rounds, so a
+     * round costs a wake-up rather than starting and joining threads
+     *
+     * the calling thread does the first part of each round itself
+     */
+    class completion_pool {
+            struct helper {
+                completion_pool* pool;
+                int part;
+                void operator()() const { pool->work(part); }
+            };
+
+            std::vector<completion_worker> _parts;
+            boost::mutex _mutex;
+            boost::condition_variable _start;
+            boost::condition_variable _done;
+            int _round;     //rounds started
+            int _pending;   //parts of the current round not yet done
+            bool _stop;
+            boost::thread_group _threads;
+
+            void work(int part) {
+                int seen = 0;
+                for(;;) {
+                    {
+                        boost::unique_lock<boost::mutex> lock(_mutex);
+                        while (!_stop && _round == seen)
+                            _start.wait(lock);
+                        if (_stop)
+                            return;
+                        seen = _round;
+                    }
+                    _parts[part]();
+                    boost::unique_lock<boost::mutex> lock(_mutex);
+                    if (--_pending == 0)
+                        _done.notify_one();
+                }
+            }
+
+        public:
+            completion_pool(int threads)
+                : _parts(threads), _round(0), _pending(0), _stop(false)
+            {
+                for(int t = 1; t < threads; ++t) {
+                    helper h = { this, t };
+                    _threads.create_thread(h);
+                }
+            }
+
+            ~completion_pool() {
+                {
+                    boost::unique_lock<boost::mutex> lock(_mutex);
+                    _stop = true;
+                }
+                _start.notify_all();
+                _threads.join_all();
+            }
+
+            int size() const { return _parts.size(); }
+
+            /** the part of the next round done by thread `t` */
+            completion_worker& operator[](int t) { return _parts[t]; }
+
+            /**
+             * run every part of the round and wait for them to finish
+             */
+            void run() {
+                {
+                    boost::unique_lock<boost::mutex> lock(_mutex);
+                    _pending = _parts.size() - 1;
+                    ++_round;
+                }
+                _start.notify_all();
+                _parts[0]();
+                boost::unique_lock<boost::mutex> lock(_mutex);
+                while (_pending > 0)
+                    _done.wait(lock);
+            }
+    };
+
+    std::size_t constituent_table::hasher::operator()(key const& k) const {
+        std::size_t seed = 0;
+        boost::hash_combine(seed, k.start);
+        boost::hash_combine(seed, k.end);
+        boost::hash_range(seed, k.head, k.head + std::strlen(k.head));
+        for(int i = 0; i < k.children->size(); ++i)
+            boost::hash_combine(seed, (*k.children)[i].get());
+        return seed;
+    }
+
+    std::size_t constituent_table::hasher::operator()(constituent_ptr const& c) const {
+        key k = { c->start(), c->end(), c->head().c_str(), &c->children() };
+        return (*this)(k);
+    }
+
+    bool constituent_table::equal::operator()(key const& k, constituent_ptr const& c) const {
+        //children are compared as objects: they were built by the same table
+        return k.start == c->start() && k.end == c->end()
+            && c->head() == k.head && *k.children == c->children();
+    }
+
+    bool constituent_table::equal::operator()(
+            constituent_ptr const& left, constituent_ptr const& right) const
+    {
+        key k = { left->start(), left->end(), left->head().c_str(), &left->children() };
+        return (*this)(k, right);
+    }
+
+    constituent_ptr constituent_table::make(
+            int start, int end, char const* head, constituent_vector const& children)
+    {
+        key k = { start, end, head, &children };
+        boost::unordered_set<constituent_ptr, hasher, equal>::const_iterator i =
+            _table.find(k, hasher(), equal());
+        if (i != _table.end())
+            return *i;
+        constituent_ptr c(new constituent(start, end, head, children));
+        _table.insert(c);
+        return c;
+    }
+
+    /**
+     * recognize
+     *
+     * runs the Earley recognizer, returning the filled chart
      *
      * verbose -- optionally dump state of chart after each step
+     * threads -- number of threads completing the items of large rounds
      */
-    constituent_vector earley(
+    chart recognize(
+            jhi::grammar const& g,
+            std::string const& start_symbol,
+            std::vector<std::string> const& input,
+            bool verbose,
+            int threads)
+    {
+        parser_context context;
+        return recognize(context, g, start_symbol, input, verbose, threads);
+    }
+
+    chart const& recognize(
+            parser_context& context,
+            jhi::grammar const& g,
+            std::string const& start_symbol,
+            std::vector<std::string> const& input,
+            bool verbose,
+            int threads)
+    {
+        return recognize(context, g, start_symbol,
+                context.word_ids(g, input.empty() ? 0 : &input[0], input.size()),
+                input.size(), verbose, threads);
+    }
+
+    chart const& recognize(
+            parser_context& context,
+            jhi::grammar const& g,
+            std::string const& start_symbol,
+            token const* input,
+            int length,
+            bool verbose,
+            int threads)
+    {
+        return recognize(context, g, start_symbol,
+                context.word_ids(g, input, length), length, verbose, threads);
+    }
+
+    chart const& recognize(
+            parser_context& context,
             jhi::grammar const& g,
             std::string const& start_symbol,
-            std::vector<std::string> input,
-            bool verbose)
+            int const* words,
+            int length,
+            bool verbose,
+            int threads)
     {
-        typedef boost::shared_ptr<jhi::arc> arc_ptr;
-        typedef std::vector<arc_ptr> chart_cell_type;
-        typedef std::vector<chart_cell_type> chart_type;
-        chart_type chart(input.size() + 1);
+        chart& c = context._chart;
+        c.reset(g, length + 1);
+        context._status = parse_finished;
+        context._finished = c.size();
+        int start = g.find(start_symbol);
+        if (start < 0)
+            return c;
+        limit_checker limits(context._limits);
+
+        std::vector<int>& predicted = context._predicted;
+        predicted.assign(g.symbol_count(), -1);
+        //symbols that can start with the next word, marked with the set
+        std::vector<int>& starts = context._starts;
+        starts.assign(g.symbol_count(), -1);
+        std::vector<int>& stack = context._stack;
+        std::vector<std::pair<int, int> >& path = context._path;
+        std::vector<int>& preds = context._preds;
+
+        //rules kept to the span bound
+        int max_span = context._max_span;
+        std::vector<char>& bounded = context._bounded;
+        bounded.clear();
+        if (max_span > 0) {
+            bounded.assign(g.size(), 1);
+            for(int r = 0; r < g.size(); ++r)
+                if (g.head(r) == start)
+                    bounded[r] = 0;
+            for(int k = 0; k < context._glue_rules.size(); ++k)
+                if (context._glue_rules[k] >= 0 && context._glue_rules[k] < g.size())
+                    bounded[context._glue_rules[k]] = 0;
+        }
+
+        //items advanced over a nullable symbol, and complete items with an
+        //empty span, for linking the two once a set is finished
+        std::vector<std::pair<int, int> >& advanced = context._advanced; //(predecessor, advanced item)
+        std::vector<int>& empty = context._empty;
+
+        //per round: reduction paths, and completions found in parallel
+        std::vector<leo_link>& leo = context._leo;
+        std::vector<std::pair<int, int> >& found = context._found; //range of completions of each item
+        std::vector<completion_vector>& completions = context._completions;
+        if (threads > 1 && completions.size() < threads)
+            completions.resize(threads);
+        //a pool shared with a copy of the context is left to the copy
+        boost::shared_ptr<completion_pool>& pool = context._pool;
+        if (threads > 1 && (!pool || pool->size() != threads || !pool.unique()))
+            pool.reset(new completion_pool(threads));
 
         //init chart
-        std::vector<jhi::rule> s_rules(g.rules_with_head(start_symbol));
-        for(int i = 0; i < s_rules.size(); ++i)
-            chart[0].push_back(arc_ptr(new arc(0, 0, s_rules[i])));
+        if (length > 0)
+            mark_left_corners(g, starts, stack, 0, words[0]);
+        predict(g, c, predicted, starts, 0, start);
 
         //fill chart
-        for(int i = 0; i < chart.size(); ++i) {
-            for(int j = 0; j < chart[i].size(); ++j) {
-                if (verbose) print_chart(chart);
-                arc_ptr a = chart[i][j];
-                if (a->complete()) {
-                    chart_cell_type cell = chart[a->start()];
-                    chart_cell_type::iterator k = chart[a->start()].begin();
-                    for( ; k != chart[a->start()].end(); ++k ) {
-                        //extend incomplete arcs that match current constituent
-                        if (!(*k)->complete() && (*k)->next_symbol() == a->constituent()->head()) {
-                            add_to_chart(chart, (*k)->extend(a->constituent()));
-                        }
+        for(int i = 0; i < c.size(); ++i) {
+            if (i > 0 && i < length)
+                mark_left_corners(g, starts, stack, i, words[i]);
+            advanced.clear();
+            empty.clear();
+            //each round processes the items added by the round before it
+            for(int j = 0, round = 0; j < c[i].size(); ) {
+                int end = c[i].size();
+                bool parallel = threads > 1 && end - j >= parallel_round;
+                if (parallel) {
+                    //find reduction paths first, as transitive() memoizes
+                    //them in the chart, then scan for completions in parallel
+                    round = j;
+                    leo.assign(end - j, leo_link(-1, item(-1, 0, 0)));
+                    found.resize(end - j);
+                    for(int k = j; k < end; ++k)
+                        if (complete(g, c[i][k]) && c[i][k].origin < i)
+                            if (leo_link const* l = transitive(g, c, c[i][k].origin, g.head(c[i][k].rule),
+                                        bounded, path, preds))
+                                leo[k - j] = *l;
+                    for(int t = 0; t < threads; ++t) {
+                        completions[t].clear();
+                        completion_worker w = { &g, &c, i, j,
+                            j + (end - j) * t / threads, j + (end - j) * (t + 1) / threads,
+                            &leo, &found, &completions[t] };
+                        (*pool)[t] = w;
                     }
-                } else {
-                    std::vector<jhi::rule> new_rules(g.rules_with_head(a->next_symbol()));
-
-                    typedef std::vector<jhi::rule>::iterator rule_iter;
-                    for(rule_iter k = new_rules.begin(); k != new_rules.end(); ++k) {
-                        add_to_chart(chart, arc_ptr(new arc(i, i, *k)));
-                        if (k->is_pos()) { //for rules that take terminals
-                            //add arc if rule matches word at current position
-                            if (i < input.size() && input[i] == k->rhs().front()) {
-                                //create child constituent for word itself
-                                constituent_ptr word(new constituent(i, i+1, input[i]));
-                                constituent_vector v; v.push_back(word);
-                                //then add arc to complete the POS rule
-                                add_to_chart(chart,
-                                        arc_ptr(new arc(i,
-                                                i+1,
-                                                boost::shared_ptr<jhi::constituent>(
-                                                    new constituent(i, i+1, k->head(), v)
-                                                ),
-                                                *k)));
-                            }
+                    pool->run();
+                }
+                for( ; j < end; ++j) {
+                    if (limits.on && (context._status = limits.check(c)) != parse_finished) {
+                        context._finished = i;
+                        break;
+                    }
+                    if (verbose) print_chart(g, c);
+                    item const a = c[i][j];
+                    if (!complete(g, a)) {
+                        int next = g.rhs(a.rule)[a.dot];
+                        if (g.terminal(next)) {
+                            //scan word at current position
+                            if (i < length && words[i] == next
+                                    && within_span(bounded, max_span, a, i + 1))
+                                c.add(i + 1, item(a.rule, a.dot + 1, a.origin),
+                                        back_pointer(i, j, -1));
+                        } else {
+                            predict(g, c, predicted, starts, i, next);
+                            //a nullable symbol may also be skipped right away
+                            //(Aycock and Horspool)
+                            if (g.nullable(next))
+                                advanced.push_back(std::make_pair(j,
+                                            c.add(i, item(a.rule, a.dot + 1, a.origin))));
                         }
+                        continue;
+                    }
+                    if (a.origin == i) {
+                        //empty constituent: items waiting for it were already
+                        //advanced when it was predicted
+                        empty.push_back(j);
+                        continue;
                     }
+                    //follow a deterministic reduction path straight to its top
+                    int head = g.head(a.rule);
+                    leo_link const* l = !parallel ? transitive(g, c, a.origin, head, bounded, path, preds)
+                        : leo[j - round].pred >= 0 ? &leo[j - round] : 0;
+                    if (l) {
+                        c.add(i, l->top, back_pointer::transitive(a.origin, head, j));
+                        continue;
+                    }
+                    if (parallel) {
+                        //the worker for this item's part of the round found them
+                        int t = 0;
+                        while (j >= round + (end - round) * (t + 1) / threads)
+                            ++t;
+                        for(int k = found[j - round].first; k < found[j - round].second; ++k)
+                            if (within_span(bounded, max_span, completions[t][k].first, i))
+                                c.add(i, completions[t][k].first, completions[t][k].second);
+                        continue;
+                    }
+                    //extend incomplete items waiting for the completed symbol
+                    item_set const& waiting = c[a.origin];
+                    int const* next = waiting.next_symbols();
+                    for(int k = 0; k < waiting.size(); ++k)
+                        if (next[k] == head && (bounded.empty() || !bounded[waiting.rule(k)]
+                                    || i - waiting.origin(k) <= max_span))
+                            c.add(i, item(waiting.rule(k), waiting.dot(k) + 1, waiting.origin(k)),
+                                    back_pointer(a.origin, k, j));
                 }
+                if (context._status != parse_finished)
+                    break;
+            }
+            if (context._status != parse_finished)
+                break;
+
+            //link items advanced over nullable symbols to the empty
+            //constituents that derive them
+            for(int k = 0; k < advanced.size(); ++k) {
+                item const& pred = c[i][advanced[k].first];
+                int symbol = g.rhs(pred.rule)[pred.dot];
+                for(int e = 0; e < empty.size(); ++e)
+                    if (g.head(c[i][empty[e]].rule) == symbol)
+                        c.add(i, item(c[i][advanced[k].second]),
+                                back_pointer(i, advanced[k].first, empty[e]));
             }
         }
 
+        //unfold the reduction paths of the parses of the whole input
+        int last = c.size() - 1;
+        for(int k = 0; k < c[last].size(); ++k)
+            if (c[last][k].origin == 0)
+                unfold_item(g, c, last, k, context._bps, context._unfolded);
+        find_goals(g, start, c, context._goals);
+        unfold_items(g, c, last, context._goals, context._seen, context._pending,
+                context._bps, context._unfolded);
 
-        //gather successful parse trees
-        std::vector<boost::shared_ptr<jhi::constituent> > parses;
-        for(int i = 0; i < chart.back().size(); ++i) {
-            if (chart.back()[i]->complete()
-                && start_symbol == chart.back()[i]->constituent()->head()) {
-                parses.push_back(chart.back()[i]->constituent());
-            }
+        return c;
+    }//recognize
+
+    void unfold(
+            jhi::grammar const& g,
+            chart& c,
+            int set,
+            std::vector<int> const& items)
+    {
+        std::vector<std::vector<char> > seen;
+        std::vector<std::pair<int, int> > stack;
+        chart::back_pointer_vector bps, out;
+        unfold_items(g, c, set, items, seen, stack, bps, out);
+    }
+
+    /**
+     * return the indices of the complete start symbol items spanning the whole input
+     */
+    std::vector<int> goal_items(
+            jhi::grammar const& g,
+            std::string const& start_symbol,
+            chart const& c)
+    {
+        std::vector<int> ret;
+        find_goals(g, g.find(start_symbol), c, ret);
+        return ret;
+    }
+
+    /**
+     * build all parse trees for the input from the chart
+     */
+    constituent_vector parse_trees(
+            jhi::grammar const& g,
+            std::string const& start_symbol,
+            chart const& c)
+    {
+        constituent_table table;
+        return parse_trees(g, start_symbol, c, table);
+    }
+
+    constituent_vector parse_trees(
+            jhi::grammar const& g,
+            std::string const& start_symbol,
+            chart const& c,
+            constituent_table& table)
+    {
+        constituent_vector parses;
+        std::vector<int> goals(goal_items(g, start_symbol, c));
+        for(int i = 0; i < goals.size(); ++i) {
+            open_vector open;
+            constituent_vector t(trees_for(g, c, c.size() - 1, goals[i], open, table));
+            parses.insert(parses.end(), t.begin(), t.end());
         }
         return parses;
+    }
+
+    /**
+     * enumerates the sequences of children for the recognized part of an
+     * item, in the order children_for() builds them: for each back pointer,
+     * each sequence for the predecessor followed by each tree for the last
+     * child
+     */
+    struct parse_enumerator::sequence_cursor {
+        parse_enumerator& e;
+        int set, i;
+        open_vector const& open; //of the tree cursor for the item's constituent
+        int b;                   //back pointer giving the current sequences
+        boost::shared_ptr<sequence_cursor> prefixes; //0 once they are used up
+        boost::shared_ptr<tree_cursor> last; //0 if the last child is a word
+        constituent_vector prefix;
+
+        sequence_cursor(parse_enumerator& e, int set, int i, open_vector const& open)
+            : e(e), set(set), i(i), open(open), b(-1) {}
+
+        bool first_child(constituent_ptr& child);
+        bool next(constituent_vector& out);
+    };
+
+    /**
+     * enumerates the trees for a complete item, as trees_for() builds them
+     */
+    struct parse_enumerator::tree_cursor {
+        parse_enumerator& e;
+        int set, i;
+        open_vector open; //the constituents being built, this one last
+        bool cut;         //this constituent is nested in itself
+        sequence_cursor children;
+        constituent_vector sequence;
+
+        tree_cursor(parse_enumerator& e, int set, int i, open_vector const& parents)
+            : e(e), set(set), i(i), open(parents), cut(false), children(e, set, i, open)
+        {
+            jhi::item const& it = e._c[set][i];
+            open_constituent self(e._g.head(it.rule), it.origin, set);
+            cut = std::find(open.begin(), open.end(), self) != open.end();
+            open.push_back(self);
+        }
+
+        bool next(constituent_ptr& out) {
+            if (cut || !children.next(sequence))
+                return false;
+            jhi::item const& it = e._c[set][i];
+            out = e.make(it.origin, set, e._g.name(e._g.head(it.rule)), sequence);
+            return true;
+        }
+    };
+
+    /**
+     * start over the trees for the last child of the current back
+     * pointer, storing the first in `child`; returns false if there are
+     * none
+     */
+    bool parse_enumerator::sequence_cursor::first_child(constituent_ptr& child) {
+        jhi::back_pointer const& bp = e._c.back_pointers(set, i)[b];
+        if (bp.child >= 0) {
+            last.reset(new tree_cursor(e, set, bp.child, open));
+            return last->next(child);
+        }
+        //the word itself, the symbol the predecessor waited for
+        last.reset();
+        child = e.make(bp.pred_set, set, e._g.name(e._c[bp.pred_set].next(bp.pred)), constituent_vector());
+        return true;
+    }
+
+    bool parse_enumerator::sequence_cursor::next(constituent_vector& out) {
+        if (e._c[set][i].dot == 0) {
+            //just the empty sequence
+            out.clear();
+            return b++ < 0;
+        }
+        jhi::chart::back_pointer_range bps = e._c.back_pointers(set, i);
+        constituent_ptr child;
+        while (true) {
+            //more sequences from the current back pointer
+            if (prefixes) {
+                if ((last && last->next(child))
+                        || (prefixes->next(prefix) && first_child(child))) {
+                    out = prefix;
+                    out.push_back(child);
+                    return true;
+                }
+            }
+            prefixes.reset();
+            if (++b >= bps.size())
+                return false;
+            if (!first_child(child))
+                continue;
+            boost::shared_ptr<sequence_cursor> p(new sequence_cursor(e, bps[b].pred_set, bps[b].pred, open));
+            if (p->next(prefix)) {
+                prefixes = p;
+                out = prefix;
+                out.push_back(child);
+                return true;
+            }
+        }
+    }
+
+    parse_enumerator::parse_enumerator(
+            jhi::grammar const& g,
+            std::string const& start_symbol,
+            chart const& c)
+        : _g(g), _c(c), _table(0), _set(c.size() - 1), _goals(goal_items(g, start_symbol, c)), _goal(0) {}
+
+    parse_enumerator::parse_enumerator(
+            jhi::grammar const& g,
+            std::string const& start_symbol,
+            chart const& c,
+            constituent_table& table)
+        : _g(g), _c(c), _table(&table), _set(c.size() - 1), _goals(goal_items(g, start_symbol, c)), _goal(0) {}
+
+    parse_enumerator::parse_enumerator(
+            jhi::grammar const& g,
+            chart const& c,
+            int set,
+            std::vector<int> const& items)
+        : _g(g), _c(c), _table(0), _set(set), _goals(items), _goal(0) {}
 
+    constituent_ptr parse_enumerator::make(
+            int start, int end, char const* head, constituent_vector const& children)
+    {
+        if (_table)
+            return _table->make(start, end, head, children);
+        return constituent_ptr(new constituent(start, end, head, children));
+    }
+
+    bool parse_enumerator::next(constituent_ptr& tree) {
+        while (!_cursor || !_cursor->next(tree)) {
+            if (_goal >= _goals.size()) {
+                _cursor.reset();
+                return false;
+            }
+            _cursor.reset(new tree_cursor(*this, _set, _goals[_goal++], open_vector()));
+        }
+        return true;
+    }
+
+    constituent_ptr first_parse(
+            jhi::grammar const& g,
+            std::string const& start_symbol,
+            chart const& c)
+    {
+        constituent_ptr tree;
+        parse_enumerator e(g, start_symbol, c);
+        e.next(tree);
+        return tree;
+    }
+
+    constituent_vector fragment_cover(
+            jhi::grammar const& g,
+            chart& c,
+            token const* input,
+            int length)
+    {
+        //best[k]: the fewest fragments covering the first k words, then the
+        //fewest bare words; from[k]: the item ending the cover, or -1 for a
+        //bare word
+        std::vector<std::pair<int, int> > best(length + 1, std::make_pair(0, 0));
+        std::vector<int> from(length + 1, -1);
+        for(int k = 1; k <= length; ++k) {
+            best[k] = std::make_pair(best[k - 1].first + 1, best[k - 1].second + 1);
+            if (k >= c.size())
+                continue;
+            chart::set_type const& set = c[k];
+            for(int i = 0; i < set.size(); ++i) {
+                int o = set.origin(i);
+                if (set.next(i) >= 0 || o == k)
+                    continue;
+                std::pair<int, int> cover(best[o].first + 1, best[o].second);
+                if (cover < best[k]) {
+                    best[k] = cover;
+                    from[k] = i;
+                }
+            }
+        }
+
+        std::vector<std::pair<int, int> > fragments; //(end, item)
+        for(int k = length; k > 0; k = from[k] < 0 ? k - 1 : c[k].origin(from[k]))
+            fragments.push_back(std::make_pair(k, from[k]));
+        std::reverse(fragments.begin(), fragments.end());
+
+        constituent_vector ret;
+        std::vector<int> items(1);
+        for(int f = 0; f < fragments.size(); ++f) {
+            int k = fragments[f].first;
+            int start = k - 1;
+            constituent_ptr tree;
+            if (fragments[f].second >= 0) {
+                items[0] = fragments[f].second;
+                start = c[k].origin(items[0]);
+                unfold(g, c, k, items);
+                parse_enumerator e(g, c, k, items);
+                e.next(tree);
+            }
+            if (tree) {
+                ret.push_back(tree);
+                continue;
+            }
+            //no tree for the item: each of its words is bare
+            for(int w = start; w < k; ++w)
+                ret.push_back(constituent_ptr(new constituent(w, w + 1, input[w].str())));
+        }
+        return ret;
+    }
+
+    /**
+     * earley
+     *
+     * runs Earley algorithm using the given grammar and input
+     *
+     * verbose -- optionally dump state of chart after each step
+     * threads -- number of threads used by recognize()
+     */
+    constituent_vector earley(
+            jhi::grammar const& g,
+            std::string const& start_symbol,
+            std::vector<std::string> const& input,
+            bool verbose,
+            int threads)
+    {
+        chart c(recognize(g, start_symbol, input, verbose, threads));
+        return parse_trees(g, start_symbol, c);
     }//earley
+
+    constituent_vector earley(
+            parser_context& context,
+            jhi::grammar const& g,
+            std::string const& start_symbol,
+            token const* input,
+            int length,
+            bool verbose,
+            int threads)
+    {
+        return parse_trees(g, start_symbol,
+                recognize(context, g, start_symbol, input, length, verbose, threads));
+    }
 }
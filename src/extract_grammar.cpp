@@ -0,0 +1,72 @@
+//      Copyright Joseph Irwin <joseph.irwin.gt@gmail.com>
+// Distributed under the Boost Software License, Version 1.0.
+//            http://www.boost.org/LICENSE_1_0.txt
+
+#include "treebank.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+/**
+ * extract_grammar - reads a treebank and writes the grammar used in it
+ *
+ * usage: extract_grammar [-j threads] [-c] [-o output] [treebank files...]
+ *
+ * input: Penn-style bracketed trees, from the given files or standard input
+ * output: a weighted grammar, one rule per line
+ *
+ * -j -- number of worker threads for file input
+ * -c -- write rule counts instead of relative frequencies
+ * -o -- write the grammar to a file instead of standard output
+ */
+int main(int argc, char** argv)
+{
+    int threads = 1;
+    bool raw_counts = false;
+    char const* output = 0;
+    std::vector<std::string> files;
+    for(int i = 1; i < argc; ++i) {
+        if (!std::strcmp(argv[i], "-j") && i + 1 < argc) {
+            threads = std::atoi(argv[++i]);
+        } else if (!std::strcmp(argv[i], "-c")) {
+            raw_counts = true;
+        } else if (!std::strcmp(argv[i], "-o") && i + 1 < argc) {
+            output = argv[++i];
+        } else if (argv[i][0] == '-' && argv[i][1]) {
+            std::cerr << "usage: " << argv[0]
+                      << " [-j threads] [-c] [-o output] [treebank files...]" << std::endl;
+            return 1;
+        } else {
+            files.push_back(argv[i]);
+        }
+    }
+
+    std::ios::sync_with_stdio(false);
+    jhi::rule_count_map counts;
+    long trees;
+    if (files.empty()) {
+        std::vector<char> buffer(1 << 20);
+        jhi::rule_extractor extractor(counts);
+        while (std::cin.read(&buffer[0], buffer.size()) || std::cin.gcount())
+            extractor.feed(&buffer[0], &buffer[0] + std::cin.gcount());
+        trees = extractor.trees();
+    } else {
+        try {
+            trees = jhi::count_rules(files, threads, counts);
+        } catch (std::exception const& e) {
+            std::cerr << e.what() << std::endl;
+            return 1;
+        }
+    }
+    std::cerr << "# trees: " << trees << ", # rules: " << counts.size() << std::endl;
+
+    if (output) {
+        std::ofstream out(output);
+        jhi::write_grammar(out, counts, raw_counts);
+    } else {
+        jhi::write_grammar(std::cout, counts, raw_counts);
+    }
+    return 0;
+}
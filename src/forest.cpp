@@ -0,0 +1,332 @@
+//      Copyright Joseph Irwin <joseph.irwin.gt@gmail.com>
+// Distributed under the Boost Software License, Version 1.0.
+//            http://www.boost.org/LICENSE_1_0.txt
+
+#include "forest.h"
+
+#include <cstring>
+#include <stdexcept>
+#include "boost/interprocess/file_mapping.hpp"
+#include "boost/interprocess/mapped_region.hpp"
+
+namespace {
+
+    char const forest_magic[8] = "JHIFRST";
+    boost::uint32_t const forest_version = 2;
+
+    /**
+     * the arrays of a forest image, in the order they are laid out
+     */
+    enum section_id {
+        symbol_offsets_section,      //uint32 x (symbols + 1): start of each name in the text
+        symbol_text_section,         //char: NUL-terminated symbol names
+        word_symbols_section,        //int32 x words: symbol of each word, or -1
+        nodes_section,               //int32 x 6 x nodes: the fields of each forest_node
+        alternative_offsets_section, //uint32 x (nodes + 1): start of each node's alternatives
+        alternatives_section,        //int32 x 2: the fields of each forest_alternative, grouped by node
+        roots_section,               //int32 x roots
+        section_count
+    };
+
+    /**
+     * start of a forest image, every field little-endian; sections follow,
+     * each aligned to 8 bytes
+     *
+     *   0  char[8] magic
+     *   8  uint32  version
+     *  12  uint32  zero
+     *  16  uint64  size of the whole image, a multiple of 8
+     *  24  uint32  words, symbols, nodes, roots
+     *  40  uint64  offset and size of each section
+     */
+    std::size_t const counts_field = 24;
+    std::size_t const sections_field = 40;
+    std::size_t const header_size = sections_field + 16 * section_count;
+    std::size_t const node_size = 24;
+    std::size_t const alternative_size = 8;
+
+    boost::uint64_t get_uint64(char const* p) {
+        return boost::uint64_t(boost::uint32_t(jhi::forest_int(p)))
+            | boost::uint64_t(boost::uint32_t(jhi::forest_int(p + 4))) << 32;
+    }
+
+    void set_uint32(char* p, boost::uint32_t n) {
+        for(int i = 0; i < 4; ++i)
+            p[i] = char(n >> 8 * i);
+    }
+
+    void set_uint64(char* p, boost::uint64_t n) {
+        set_uint32(p, boost::uint32_t(n));
+        set_uint32(p + 4, boost::uint32_t(n >> 32));
+    }
+
+    /**
+     * lays out the sections of a forest image in one buffer
+     */
+    class image_writer {
+            std::vector<char>& _buf;
+
+            std::size_t start(section_id id, std::size_t size) {
+                _buf.resize((_buf.size() + 7) & ~std::size_t(7), 0);
+                std::size_t offset = _buf.size();
+                _buf.resize(offset + size);
+                set_uint64(&_buf[sections_field + 16 * id], offset);
+                set_uint64(&_buf[sections_field + 16 * id + 8], size);
+                return offset;
+            }
+
+        public:
+            image_writer(std::vector<char>& buf) : _buf(buf) {
+                _buf.assign(header_size, 0);
+                std::memcpy(&_buf[0], forest_magic, sizeof(forest_magic));
+                set_uint32(&_buf[8], forest_version);
+            }
+
+            /** a section of 32-bit integers */
+            template <typename Int>
+            void put(section_id id, std::vector<Int> const& data) {
+                std::size_t offset = start(id, 4 * data.size());
+                for(int i = 0; i < data.size(); ++i)
+                    set_uint32(&_buf[offset + 4 * i], data[i]);
+            }
+
+            void put(section_id id, std::vector<char> const& text) {
+                std::size_t offset = start(id, text.size());
+                if (!text.empty())
+                    std::memcpy(&_buf[offset], &text[0], text.size());
+            }
+
+            void finish(int words, int symbols, int nodes, int roots) {
+                _buf.resize((_buf.size() + 7) & ~std::size_t(7), 0);
+                set_uint64(&_buf[16], _buf.size());
+                set_uint32(&_buf[counts_field], words);
+                set_uint32(&_buf[counts_field + 4], symbols);
+                set_uint32(&_buf[counts_field + 8], nodes);
+                set_uint32(&_buf[counts_field + 12], roots);
+            }
+    };
+
+    void bad_forest(char const* what) {
+        throw std::runtime_error(std::string("forest image: ") + what);
+    }
+
+    /**
+     * true if the `n` + 1 little-endian offsets at `p` never decrease and
+     * the last is within `limit`
+     */
+    bool valid_offsets(char const* p, std::size_t n, std::size_t limit) {
+        for(std::size_t i = 0; i < n; ++i)
+            if (boost::uint32_t(jhi::forest_int(p + 4 * i)) > boost::uint32_t(jhi::forest_int(p + 4 * i + 4)))
+                return false;
+        return boost::uint32_t(jhi::forest_int(p + 4 * n)) <= limit;
+    }
+
+    /**
+     * true if every `stride`-th little-endian int at `p`, `n` in all, is at
+     * least `low` and below `limit`
+     */
+    bool valid_ids(char const* p, std::size_t n, std::size_t stride, boost::int64_t low, boost::int64_t limit) {
+        for(std::size_t i = 0; i < n; ++i) {
+            boost::int32_t id = jhi::forest_int(p + 4 * stride * i);
+            if (id < low || id >= limit)
+                return false;
+        }
+        return true;
+    }
+
+    /**
+     * the id of a symbol in the forest's table, adding it if needed
+     */
+    int forest_symbol(
+            jhi::grammar const& g,
+            int symbol,
+            std::vector<int>& ids,
+            std::vector<boost::uint32_t>& offsets,
+            std::vector<char>& text)
+    {
+        if (ids[symbol] < 0) {
+            ids[symbol] = offsets.size() - 1;
+            char const* name = g.name(symbol);
+            text.insert(text.end(), name, name + std::strlen(name) + 1);
+            offsets.push_back(text.size());
+        }
+        return ids[symbol];
+    }
+
+}//namespace
+
+namespace jhi {
+
+    forest::forest(char const* image, std::size_t size, boost::shared_ptr<void const> storage)
+        : _storage(storage), _image(image), _available(size)
+    {
+        if (size < header_size
+                || std::memcmp(image, forest_magic, sizeof(forest_magic)))
+            bad_forest("not a forest image");
+        if (boost::uint32_t(forest_int(image + 8)) != forest_version)
+            bad_forest("unsupported version");
+        boost::uint64_t image_size = get_uint64(image + 16);
+        if (image_size > size || image_size < header_size)
+            bad_forest("truncated");
+        _size = image_size;
+
+        boost::uint64_t offset[section_count], length[section_count];
+        for(int i = 0; i < section_count; ++i) {
+            offset[i] = get_uint64(image + sections_field + 16 * i);
+            length[i] = get_uint64(image + sections_field + 16 * i + 8);
+            if (offset[i] % 8 || offset[i] > _size || length[i] > _size - offset[i])
+                bad_forest("section out of bounds");
+        }
+        boost::uint64_t words = boost::uint32_t(forest_int(image + counts_field));
+        boost::uint64_t symbols = boost::uint32_t(forest_int(image + counts_field + 4));
+        boost::uint64_t nodes = boost::uint32_t(forest_int(image + counts_field + 8));
+        boost::uint64_t roots = boost::uint32_t(forest_int(image + counts_field + 12));
+        if (length[symbol_offsets_section] != (symbols + 1) * 4
+                || length[word_symbols_section] != words * 4
+                || length[nodes_section] != nodes * node_size
+                || length[alternative_offsets_section] != (nodes + 1) * 4
+                || length[alternatives_section] % alternative_size
+                || length[roots_section] != roots * 4
+                || words > 0x7fffffff || nodes > 0x7fffffff)
+            bad_forest("inconsistent section sizes");
+
+        _words = words;
+        _symbols = symbols;
+        _nodes = nodes;
+        _roots = roots;
+        _symbol_offsets = image + offset[symbol_offsets_section];
+        _symbol_text = image + offset[symbol_text_section];
+        _word_symbols = image + offset[word_symbols_section];
+        _node_array = image + offset[nodes_section];
+        _alternative_offsets = image + offset[alternative_offsets_section];
+        _alternatives = image + offset[alternatives_section];
+        _root_nodes = image + offset[roots_section];
+
+        //every index must stay within its section and every id within the
+        //forest, as readers follow them unchecked
+        if (!valid_offsets(_symbol_offsets, symbols, length[symbol_text_section]))
+            bad_forest("symbol names out of bounds");
+        for(boost::uint64_t s = 0; s < symbols; ++s) {
+            boost::uint32_t end = forest_int(_symbol_offsets + 4 * (s + 1));
+            if (boost::uint32_t(forest_int(_symbol_offsets + 4 * s)) == end || _symbol_text[end - 1])
+                bad_forest("symbol name not terminated");
+        }
+        if (!valid_ids(_word_symbols, words, 1, -1, symbols))
+            bad_forest("word symbol out of range");
+
+        if (!valid_ids(_node_array, nodes, 6, 0, symbols))
+            bad_forest("node symbol out of range");
+        for(int n = 0; n < _nodes; ++n) {
+            forest_node const node = (*this)[n];
+            if (node.length < 0 || node.dot < 0 || node.dot > node.length
+                    || node.start < 0 || node.start > node.end || node.end > _words)
+                bad_forest("node out of bounds");
+        }
+
+        boost::uint64_t alternatives = length[alternatives_section] / alternative_size;
+        if (!valid_offsets(_alternative_offsets, nodes, alternatives))
+            bad_forest("bad alternative index");
+        if (!valid_ids(_alternatives, alternatives, 2, -1, nodes)
+                || !valid_ids(_alternatives + 4, alternatives, 2, -boost::int64_t(words), nodes))
+            bad_forest("alternative out of range");
+        if (!valid_ids(_root_nodes, roots, 1, 0, nodes))
+            bad_forest("root out of range");
+    }
+
+    forest forest::map(std::string const& path) {
+        namespace bip = boost::interprocess;
+        bip::file_mapping file(path.c_str(), bip::read_only);
+        boost::shared_ptr<bip::mapped_region> region(
+                new bip::mapped_region(file, bip::read_only));
+        return forest(static_cast<char const*>(region->get_address()), region->get_size(), region);
+    }
+
+    void forest_image(
+            jhi::grammar const& g,
+            std::string const& start_symbol,
+            chart const& c,
+            std::vector<char>& image)
+    {
+        //number the items reachable from the parses; items with nothing
+        //recognized only start a rule, so they are left out, but empty
+        //constituents are kept
+        std::vector<int> roots(goal_items(g, start_symbol, c));
+        std::vector<std::vector<int> > ids(c.size());
+        std::vector<std::pair<int, int> > items; //(set, index) of each node
+        std::vector<std::pair<int, int> > stack;
+        int last = c.size() - 1;
+        for(int k = 0; k < roots.size(); ++k)
+            stack.push_back(std::make_pair(last, roots[k]));
+        while (!stack.empty()) {
+            int s = stack.back().first, i = stack.back().second;
+            stack.pop_back();
+            if (ids[s].size() <= i)
+                ids[s].resize(c[s].size(), -1);
+            if (ids[s][i] >= 0 || (c[s].dot(i) == 0 && g.length(c[s].rule(i)) > 0))
+                continue;
+            ids[s][i] = items.size();
+            items.push_back(std::make_pair(s, i));
+            for(int b = 0; b < c.back_pointers(s, i).size(); ++b) {
+                back_pointer bp = c.back_pointers(s, i)[b];
+                stack.push_back(std::make_pair(bp.pred_set, bp.pred));
+                if (bp.child >= 0)
+                    stack.push_back(std::make_pair(s, bp.child));
+            }
+        }
+        for(int k = 0; k < roots.size(); ++k)
+            roots[k] = ids[last][roots[k]];
+
+        std::vector<int> symbol_ids(g.symbol_count(), -1);
+        std::vector<boost::uint32_t> symbol_offsets(1, 0);
+        std::vector<char> symbol_text;
+        std::vector<boost::int32_t> words(last, -1);
+        std::vector<boost::int32_t> nodes; //the fields of each node
+        nodes.reserve(6 * items.size());
+        std::vector<boost::uint32_t> alternative_offsets(1, 0);
+        std::vector<boost::int32_t> alternatives; //(pred, child) of each alternative
+        for(int n = 0; n < items.size(); ++n) {
+            int s = items[n].first, i = items[n].second;
+            item const it = c[s][i];
+            boost::int32_t node[] = { forest_symbol(g, g.head(it.rule), symbol_ids, symbol_offsets, symbol_text),
+                it.rule, it.dot, g.length(it.rule), it.origin, s };
+            nodes.insert(nodes.end(), node, node + 6);
+            for(int b = 0; b < c.back_pointers(s, i).size(); ++b) {
+                back_pointer const& bp = c.back_pointers(s, i)[b];
+                forest_alternative a;
+                a.pred = c[bp.pred_set].dot(bp.pred) == 0 ? -1 : ids[bp.pred_set][bp.pred];
+                if (bp.child >= 0) {
+                    a.child = ids[s][bp.child];
+                } else {
+                    a.child = -1 - bp.pred_set;
+                    words[bp.pred_set] = forest_symbol(g, g.rhs(it.rule)[it.dot - 1],
+                            symbol_ids, symbol_offsets, symbol_text);
+                }
+                alternatives.push_back(a.pred);
+                alternatives.push_back(a.child);
+            }
+            alternative_offsets.push_back(alternatives.size() / 2);
+        }
+
+        image_writer w(image);
+        w.put(symbol_offsets_section, symbol_offsets);
+        w.put(symbol_text_section, symbol_text);
+        w.put(word_symbols_section, words);
+        w.put(nodes_section, nodes);
+        w.put(alternative_offsets_section, alternative_offsets);
+        w.put(alternatives_section, alternatives);
+        w.put(roots_section, std::vector<boost::int32_t>(roots.begin(), roots.end()));
+        w.finish(last, symbol_offsets.size() - 1, items.size(), roots.size());
+    }
+
+    void write_forest(
+            std::ostream& out,
+            jhi::grammar const& g,
+            std::string const& start_symbol,
+            chart const& c)
+    {
+        std::vector<char> image;
+        forest_image(g, start_symbol, c, image);
+        out.write(&image[0], image.size());
+    }
+
+}//namespace jhi
@@ -0,0 +1,156 @@
+//      Copyright Joseph Irwin <joseph.irwin.gt@gmail.com>
+// Distributed under the Boost Software License, Version 1.0.
+//            http://www.boost.org/LICENSE_1_0.txt
+
+#ifndef __PARSER__FOREST_H__
+#define __PARSER__FOREST_H__
+
+#include "chart.h"
+
+namespace jhi {
+
+    /**
+     * the little-endian 32-bit integer at `p`
+     */
+    inline boost::int32_t forest_int(char const* p) {
+        unsigned char const* b = reinterpret_cast<unsigned char const*>(p);
+        return boost::int32_t(boost::uint32_t(b[0]) | boost::uint32_t(b[1]) << 8
+                | boost::uint32_t(b[2]) << 16 | boost::uint32_t(b[3]) << 24);
+    }
+
+    /**
+     * a node of a packed forest: a constituent (a complete item) or the first
+     * `dot` children of a rule (an incomplete item), spanning words
+     * [start, end); an empty constituent has no alternatives
+     */
+    struct forest_node {
+        boost::int32_t symbol; //head of the rule, in the forest's symbol table
+        boost::int32_t rule;   //rule id in the grammar
+        boost::int32_t dot;    //children covered by the node
+        boost::int32_t length; //children of the rule; the node is a constituent if dot == length
+        boost::int32_t start;
+        boost::int32_t end;
+    };
+
+    /**
+     * one way of deriving a forest node: its last child, after the node for
+     * the children before that one
+     */
+    struct forest_alternative {
+        boost::int32_t pred;  //node for the children before the last, or -1 if there are none
+        boost::int32_t child; //node of the last child, or -1 - i for the word at position i
+    };
+
+    /**
+     * class forest
+     *
+     * a packed parse forest in the binary form written by write_forest(),
+     * used in place: the image holds a symbol table, the symbol of each word,
+     * the nodes, the alternatives of each node and the roots (constituents
+     * of the start symbol over the whole input), as fixed-width fields laid
+     * out in arrays; fields are decoded as they are read
+     *
+     * nodes are shared between every tree using them, so the forest stays
+     * polynomial in the sentence length however many trees it holds
+     *
+     * every integer is stored little-endian, like the records of
+     * tree_writer's binary format, so an image reads the same on any
+     * machine; images can be concatenated, each one recording its own size
+     */
+    class forest {
+            boost::shared_ptr<void const> _storage;
+            char const* _image;
+            std::size_t _size;
+            std::size_t _available; //bytes from the image to the end of the block
+            int _words, _symbols, _nodes, _roots;
+            char const* _symbol_offsets;
+            char const* _symbol_text;
+            char const* _word_symbols;
+            char const* _node_array;
+            char const* _alternative_offsets;
+            char const* _alternatives;
+            char const* _root_nodes;
+
+        public:
+            /**
+             * use the forest image at the start of the given block in place;
+             * `storage` keeps the block alive
+             *
+             * throws std::runtime_error if the block does not start with a
+             * forest image, or if any index in the image is out of range
+             */
+            forest(char const* image, std::size_t size,
+                    boost::shared_ptr<void const> storage = boost::shared_ptr<void const>());
+
+            /** map a file holding forest images and use the first in place */
+            static forest map(std::string const& path);
+
+            /** the bytes of the image */
+            std::size_t image_size() const { return _size; }
+            char const* image() const { return _image; }
+
+            /** true if the block holds more data after this image */
+            bool more() const { return _available > _size; }
+            /** the image following this one in the block */
+            forest next() const { return forest(_image + _size, _available - _size, _storage); }
+
+            /** number of words in the sentence */
+            int words() const { return _words; }
+            /** symbol of the word at a position, or -1 if no parse uses it */
+            int word(int position) const { return forest_int(_word_symbols + 4 * position); }
+
+            int symbol_count() const { return _symbols; }
+            char const* name(int symbol) const {
+                return _symbol_text + forest_int(_symbol_offsets + 4 * symbol);
+            }
+
+            int size() const { return _nodes; }
+            forest_node operator[](int node) const {
+                char const* p = _node_array + 24 * node;
+                forest_node n = { forest_int(p), forest_int(p + 4), forest_int(p + 8),
+                    forest_int(p + 12), forest_int(p + 16), forest_int(p + 20) };
+                return n;
+            }
+
+            /** the range of indices of a node's alternatives (see alternative) */
+            int alternatives_begin(int node) const {
+                return forest_int(_alternative_offsets + 4 * node);
+            }
+            int alternatives_end(int node) const {
+                return forest_int(_alternative_offsets + 4 * (node + 1));
+            }
+            forest_alternative alternative(int a) const {
+                char const* p = _alternatives + 8 * a;
+                forest_alternative alt = { forest_int(p), forest_int(p + 4) };
+                return alt;
+            }
+
+            int root_count() const { return _roots; }
+            int root(int k) const { return forest_int(_root_nodes + 4 * k); }
+    };
+
+    /**
+     * write the packed forest of the parses in a chart from recognize() as
+     * one forest image, with a single write
+     *
+     * only the nodes reachable from the parses of the whole input are
+     * written, and only the symbols they use
+     */
+    void write_forest(
+            std::ostream& out,
+            jhi::grammar const& g,
+            std::string const& start_symbol,
+            chart const& c);
+
+    /**
+     * build the forest image of the parses in a chart (see write_forest)
+     */
+    void forest_image(
+            jhi::grammar const& g,
+            std::string const& start_symbol,
+            chart const& c,
+            std::vector<char>& image);
+
+}//namespace jhi
+
+#endif //__PARSER__FOREST_H__
@@ -0,0 +1,518 @@
+//      Copyright Joseph Irwin <joseph.irwin.gt@gmail.com>
+// Distributed under the Boost Software License, Version 1.0.
+//            http://www.boost.org/LICENSE_1_0.txt
+
+#include "grammar.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include "boost/interprocess/file_mapping.hpp"
+#include "boost/interprocess/mapped_region.hpp"
+
+namespace {
+
+    char const image_magic[8] = "JHIGRAM";
+    boost::uint32_t const image_version = 3;
+    boost::uint32_t const byte_order_mark = 0x01020304;
+
+    /**
+     * the arrays of a grammar image, in the order they are laid out
+     */
+    enum section_id {
+        symbol_offsets_section,  //uint32 x (symbols + 1): start of each name in the text
+        symbol_text_section,     //char: NUL-terminated symbol names
+        symbol_flags_section,    //uint8 x symbols: grammar::symbol_flag bits
+        symbol_hash_section,     //int32 x 2^k: open-addressed table of symbol ids
+        rules_section,           //rule_record x rules
+        rhs_section,             //int32: right-hand side symbols of every rule
+        weights_section,         //double x rules
+        head_offsets_section,    //uint32 x (symbols + 1): start of each symbol's rules
+        head_rules_section,      //int32 x rules: rule ids grouped by head
+        closure_offsets_section, //uint32 x (symbols + 1): start of each symbol's closure
+        closure_symbols_section, //int32: non-terminals to predict for each symbol
+        corner_offsets_section,  //uint32 x (symbols + 1): start of each symbol's parents
+        corner_heads_section,    //int32: heads of the rules each symbol can start
+        section_count
+    };
+
+    struct section {
+        boost::uint64_t offset;
+        boost::uint64_t size;
+    };
+
+    /**
+     * start of a grammar image; sections follow, each aligned to 8 bytes
+     */
+    struct image_header {
+        char magic[8];
+        boost::uint32_t version;
+        boost::uint32_t byte_order;
+        boost::uint32_t symbols;
+        boost::uint32_t rules;
+        section sections[section_count];
+    };
+
+    /**
+     * FNV-1a hash of a symbol name (the image must not depend on the library's hash)
+     */
+    inline boost::uint64_t hash_name(char const* name, std::size_t length) {
+        boost::uint64_t h = UINT64_C(14695981039346656037);
+        for(std::size_t i = 0; i < length; ++i) {
+            h ^= (unsigned char)name[i];
+            h *= UINT64_C(1099511628211);
+        }
+        return h;
+    }
+
+    /**
+     * lays out the sections of a grammar image in one buffer
+     */
+    class image_writer {
+            std::vector<char>& _buf;
+        public:
+            image_writer(std::vector<char>& buf) : _buf(buf) {
+                _buf.assign(sizeof(image_header), 0);
+                image_header& h = header();
+                std::memcpy(h.magic, image_magic, sizeof(h.magic));
+                h.version = image_version;
+                h.byte_order = byte_order_mark;
+            }
+
+            image_header& header() { return *reinterpret_cast<image_header*>(&_buf[0]); }
+
+            template <typename T>
+            void put(section_id id, std::vector<T> const& data) {
+                _buf.resize((_buf.size() + 7) & ~std::size_t(7), 0);
+                std::size_t offset = _buf.size();
+                std::size_t size = data.size() * sizeof(T);
+                _buf.resize(offset + size);
+                if (size)
+                    std::memcpy(&_buf[offset], &data[0], size);
+                header().sections[id].offset = offset;
+                header().sections[id].size = size;
+            }
+    };
+
+    void bad_image(char const* what) {
+        throw std::runtime_error(std::string("grammar image: ") + what);
+    }
+
+    /**
+     * true if the `n` + 1 offsets of an index never decrease and the last
+     * is within `limit`
+     */
+    bool valid_offsets(boost::uint32_t const* offsets, std::size_t n, std::size_t limit) {
+        for(std::size_t i = 0; i < n; ++i)
+            if (offsets[i] > offsets[i + 1])
+                return false;
+        return offsets[n] <= limit;
+    }
+
+    /**
+     * true if each of the `n` ids is at least `low` and below `limit`
+     */
+    bool valid_ids(boost::int32_t const* ids, std::size_t n, int low, std::size_t limit) {
+        for(std::size_t i = 0; i < n; ++i)
+            if (ids[i] < low || ids[i] >= boost::int64_t(limit))
+                return false;
+        return true;
+    }
+
+    void bad_line(int line, char const* what) {
+        std::ostringstream msg;
+        msg << "grammar line " << line << ": " << what;
+        throw std::runtime_error(msg.str());
+    }
+
+    inline bool is_blank(char ch) {
+        return ch == ' ' || ch == '\t' || ch == '\r';
+    }
+}
+
+namespace jhi {
+
+    grammar::grammar(boost::shared_ptr<void const> storage, char const* image, std::size_t size)
+        : _storage(storage), _image(image), _image_size(size)
+    {
+        if (size < sizeof(image_header)
+                || std::memcmp(image, image_magic, sizeof(image_magic)))
+            bad_image("not a grammar image");
+        image_header const& h = *reinterpret_cast<image_header const*>(image);
+        if (h.version != image_version)
+            bad_image("unsupported version");
+        if (h.byte_order != byte_order_mark)
+            bad_image("written on a machine with a different byte order");
+
+        for(int i = 0; i < section_count; ++i) {
+            section const& s = h.sections[i];
+            if (s.offset % 8 || s.offset > size || s.size > size - s.offset)
+                bad_image("section out of bounds");
+        }
+        std::size_t symbols = h.symbols, rules = h.rules;
+        std::size_t hash_size = h.sections[symbol_hash_section].size / 4;
+        if (h.sections[symbol_offsets_section].size != (symbols + 1) * 4
+                || h.sections[symbol_flags_section].size != symbols
+                || hash_size & (hash_size - 1) || hash_size < 1
+                || h.sections[rules_section].size != rules * sizeof(rule_record)
+                || h.sections[weights_section].size != rules * sizeof(double)
+                || h.sections[head_offsets_section].size != (symbols + 1) * 4
+                || h.sections[head_rules_section].size != rules * 4
+                || h.sections[closure_offsets_section].size != (symbols + 1) * 4
+                || h.sections[corner_offsets_section].size != (symbols + 1) * 4
+                || h.sections[rhs_section].size % 4
+                || h.sections[closure_symbols_section].size % 4
+                || h.sections[corner_heads_section].size % 4)
+            bad_image("inconsistent section sizes");
+
+        _symbol_count = symbols;
+        _rule_count = rules;
+        _symbol_offsets = reinterpret_cast<boost::uint32_t const*>(
+                image + h.sections[symbol_offsets_section].offset);
+        _symbol_text = image + h.sections[symbol_text_section].offset;
+        _symbol_flags = reinterpret_cast<boost::uint8_t const*>(
+                image + h.sections[symbol_flags_section].offset);
+        _symbol_hash = reinterpret_cast<boost::int32_t const*>(
+                image + h.sections[symbol_hash_section].offset);
+        _symbol_hash_mask = hash_size - 1;
+        _rules = reinterpret_cast<rule_record const*>(
+                image + h.sections[rules_section].offset);
+        _rhs = reinterpret_cast<boost::int32_t const*>(
+                image + h.sections[rhs_section].offset);
+        _weights = reinterpret_cast<double const*>(
+                image + h.sections[weights_section].offset);
+        _head_offsets = reinterpret_cast<boost::uint32_t const*>(
+                image + h.sections[head_offsets_section].offset);
+        _head_rules = reinterpret_cast<boost::int32_t const*>(
+                image + h.sections[head_rules_section].offset);
+        _closure_offsets = reinterpret_cast<boost::uint32_t const*>(
+                image + h.sections[closure_offsets_section].offset);
+        _closure_symbols = reinterpret_cast<boost::int32_t const*>(
+                image + h.sections[closure_symbols_section].offset);
+        _corner_offsets = reinterpret_cast<boost::uint32_t const*>(
+                image + h.sections[corner_offsets_section].offset);
+        _corner_heads = reinterpret_cast<boost::int32_t const*>(
+                image + h.sections[corner_heads_section].offset);
+
+        //every index must stay within its section and every id within the
+        //grammar, as the parser follows them unchecked
+        std::size_t text_size = h.sections[symbol_text_section].size;
+        if (!valid_offsets(_symbol_offsets, symbols, text_size))
+            bad_image("symbol names out of bounds");
+        for(std::size_t s = 0; s < symbols; ++s)
+            if (_symbol_offsets[s] == _symbol_offsets[s + 1] || _symbol_text[_symbol_offsets[s + 1] - 1])
+                bad_image("symbol name not terminated");
+        bool empty_slot = false;
+        for(std::size_t i = 0; i < hash_size; ++i)
+            empty_slot |= _symbol_hash[i] < 0;
+        if (!valid_ids(_symbol_hash, hash_size, -1, symbols) || !empty_slot)
+            bad_image("bad symbol table");
+
+        std::size_t rhs_size = h.sections[rhs_section].size / 4;
+        for(std::size_t r = 0; r < rules; ++r)
+            if (_rules[r].head < 0 || _rules[r].head >= boost::int64_t(symbols)
+                    || _rules[r].rhs < 0 || _rules[r].length < 0
+                    || boost::uint64_t(_rules[r].rhs) + _rules[r].length > rhs_size)
+                bad_image("rule out of bounds");
+        if (!valid_ids(_rhs, rhs_size, 0, symbols))
+            bad_image("right-hand side symbol out of range");
+
+        if (!valid_offsets(_head_offsets, symbols, rules)
+                || !valid_ids(_head_rules, rules, 0, rules))
+            bad_image("bad rule index");
+        if (!valid_offsets(_closure_offsets, symbols, h.sections[closure_symbols_section].size / 4)
+                || !valid_ids(_closure_symbols, h.sections[closure_symbols_section].size / 4, 0, symbols))
+            bad_image("bad closure index");
+        if (!valid_offsets(_corner_offsets, symbols, h.sections[corner_heads_section].size / 4)
+                || !valid_ids(_corner_heads, h.sections[corner_heads_section].size / 4, 0, symbols))
+            bad_image("bad left-corner index");
+    }
+
+    grammar::grammar(std::vector<rule> const& rules) {
+        grammar_builder b;
+        for(int i = 0; i < rules.size(); ++i)
+            b.add(rules[i]);
+        *this = b.build();
+    }
+
+    grammar grammar::map(std::string const& path) {
+        namespace bip = boost::interprocess;
+        bip::file_mapping file(path.c_str(), bip::read_only);
+        boost::shared_ptr<bip::mapped_region> region(
+                new bip::mapped_region(file, bip::read_only));
+        return grammar(region,
+                static_cast<char const*>(region->get_address()), region->get_size());
+    }
+
+    void grammar::save(std::ostream& out) const {
+        out.write(_image, _image_size);
+    }
+
+    int grammar::find(char const* name, std::size_t length) const {
+        boost::uint32_t slot = hash_name(name, length) & _symbol_hash_mask;
+        for( ; ; slot = (slot + 1) & _symbol_hash_mask) {
+            int id = _symbol_hash[slot];
+            if (id < 0)
+                return -1;
+            if (_symbol_offsets[id + 1] - _symbol_offsets[id] == length + 1
+                    && !std::memcmp(this->name(id), name, length))
+                return id;
+        }
+    }
+
+    rule grammar::operator[](int r) const {
+        std::vector<std::string> rhs;
+        for(int i = 0; i < length(r); ++i)
+            rhs.push_back(name(this->rhs(r)[i]));
+        return rule(name(head(r)), rhs);
+    }
+
+    void grammar::write_rule(std::ostream& out, int r) const {
+        out << name(head(r)) << " -->";
+        id_range rhs = this->rhs(r);
+        for(int i = 0; i < rhs.size(); ++i)
+            out << " " << name(rhs[i]);
+    }
+
+    int grammar_builder::symbol(std::string const& name) {
+        std::pair<boost::unordered_map<std::string, int>::iterator, bool> r
+            = _ids.insert(std::make_pair(name, (int)_names.size()));
+        if (r.second)
+            _names.push_back(name);
+        return r.first->second;
+    }
+
+    int grammar_builder::add(int head, int const* rhs, int length, double weight) {
+        rule_record r = { head, (boost::int32_t)_rhs.size(), length };
+        _rules.push_back(r);
+        _rhs.insert(_rhs.end(), rhs, rhs + length);
+        _weights.push_back(weight);
+        return _rules.size() - 1;
+    }
+
+    int grammar_builder::add(rule const& r, double weight) {
+        rule_record rec = { symbol(r.head()), (boost::int32_t)_rhs.size(), (boost::int32_t)r.rhs().size() };
+        for(int i = 0; i < r.rhs().size(); ++i)
+            _rhs.push_back(symbol(r.rhs()[i]));
+        _rules.push_back(rec);
+        _weights.push_back(weight);
+        return _rules.size() - 1;
+    }
+
+    grammar grammar_builder::build() const {
+        int symbols = _names.size();
+        int rules = _rules.size();
+
+        //symbol names, flags and lookup table
+        std::vector<boost::uint32_t> offsets(1, 0);
+        std::vector<char> text;
+        std::vector<boost::uint8_t> flags(symbols, 0);
+        for(int s = 0; s < symbols; ++s) {
+            text.insert(text.end(), _names[s].begin(), _names[s].end());
+            text.push_back('\0');
+            offsets.push_back(text.size());
+            if (is_terminal(_names[s]))
+                flags[s] |= grammar::terminal_flag;
+        }
+        std::size_t hash_size = 2;
+        while (hash_size < 2 * symbols)
+            hash_size *= 2;
+        std::vector<boost::int32_t> table(hash_size, -1);
+        for(int s = 0; s < symbols; ++s) {
+            std::size_t slot = hash_name(_names[s].data(), _names[s].size()) & (hash_size - 1);
+            while (table[slot] >= 0)
+                slot = (slot + 1) & (hash_size - 1);
+            table[slot] = s;
+        }
+
+        //rules grouped by head
+        std::vector<boost::uint32_t> head_offsets(symbols + 1, 0);
+        for(int r = 0; r < rules; ++r)
+            ++head_offsets[_rules[r].head + 1];
+        for(int s = 0; s < symbols; ++s)
+            head_offsets[s + 1] += head_offsets[s];
+        std::vector<boost::int32_t> head_rules(rules);
+        std::vector<boost::uint32_t> fill(head_offsets.begin(), head_offsets.end() - 1);
+        for(int r = 0; r < rules; ++r)
+            head_rules[fill[_rules[r].head]++] = r;
+
+        //nullable symbols: count the symbols of each rule not yet known to be
+        //nullable, and mark a head nullable when one of its rules reaches zero
+        std::vector<boost::uint32_t> uses(symbols + 1, 0);
+        for(int i = 0; i < _rhs.size(); ++i)
+            ++uses[_rhs[i] + 1];
+        for(int s = 0; s < symbols; ++s)
+            uses[s + 1] += uses[s];
+        std::vector<boost::int32_t> used_by(_rhs.size());
+        std::vector<int> left(rules);
+        std::vector<int> work;
+        fill.assign(uses.begin(), uses.end() - 1);
+        for(int r = 0; r < rules; ++r) {
+            left[r] = _rules[r].length;
+            for(int i = 0; i < _rules[r].length; ++i)
+                used_by[fill[_rhs[_rules[r].rhs + i]]++] = r;
+            if (left[r] == 0 && !(flags[_rules[r].head] & grammar::nullable_flag)) {
+                flags[_rules[r].head] |= grammar::nullable_flag;
+                work.push_back(_rules[r].head);
+            }
+        }
+        while (!work.empty()) {
+            int s = work.back();
+            work.pop_back();
+            for(int i = uses[s]; i < uses[s + 1]; ++i) {
+                int r = used_by[i];
+                if (--left[r] == 0 && !(flags[_rules[r].head] & grammar::nullable_flag)) {
+                    flags[_rules[r].head] |= grammar::nullable_flag;
+                    work.push_back(_rules[r].head);
+                }
+            }
+        }
+
+        //prediction closure: non-terminals reachable through left corners,
+        //looking past nullable symbols
+        std::vector<boost::uint32_t> closure_offsets(1, 0);
+        std::vector<boost::int32_t> closure;
+        std::vector<int> seen(symbols, -1);
+        for(int s = 0; s < symbols; ++s) {
+            if (!(flags[s] & grammar::terminal_flag)) {
+                std::size_t begin = closure.size();
+                closure.push_back(s);
+                seen[s] = s;
+                for(std::size_t k = begin; k < closure.size(); ++k) {
+                    int a = closure[k];
+                    for(int i = head_offsets[a]; i < head_offsets[a + 1]; ++i) {
+                        rule_record const& r = _rules[head_rules[i]];
+                        for(int d = 0; d < r.length; ++d) {
+                            int b = _rhs[r.rhs + d];
+                            if (flags[b] & grammar::terminal_flag)
+                                break;
+                            if (seen[b] != s) {
+                                seen[b] = s;
+                                closure.push_back(b);
+                            }
+                            if (!(flags[b] & grammar::nullable_flag))
+                                break;
+                        }
+                    }
+                }
+            }
+            closure_offsets.push_back(closure.size());
+        }
+
+        //left-corner parents: for each symbol, the heads of the rules it can
+        //start, looking past nullable symbols
+        std::vector<std::pair<int, int> > corners; //(symbol, head)
+        for(int r = 0; r < rules; ++r) {
+            for(int d = 0; d < _rules[r].length; ++d) {
+                int b = _rhs[_rules[r].rhs + d];
+                corners.push_back(std::make_pair(b, (int)_rules[r].head));
+                if (!(flags[b] & grammar::nullable_flag))
+                    break;
+            }
+        }
+        std::sort(corners.begin(), corners.end());
+        corners.erase(std::unique(corners.begin(), corners.end()), corners.end());
+        std::vector<boost::uint32_t> corner_offsets(symbols + 1, 0);
+        std::vector<boost::int32_t> corner_heads(corners.size());
+        for(int i = 0; i < corners.size(); ++i) {
+            ++corner_offsets[corners[i].first + 1];
+            corner_heads[i] = corners[i].second;
+        }
+        for(int s = 0; s < symbols; ++s)
+            corner_offsets[s + 1] += corner_offsets[s];
+
+        boost::shared_ptr<std::vector<char> > buf(new std::vector<char>);
+        image_writer w(*buf);
+        w.put(symbol_offsets_section, offsets);
+        w.put(symbol_text_section, text);
+        w.put(symbol_flags_section, flags);
+        w.put(symbol_hash_section, table);
+        w.put(rules_section, _rules);
+        w.put(rhs_section, std::vector<boost::int32_t>(_rhs.begin(), _rhs.end()));
+        w.put(weights_section, _weights);
+        w.put(head_offsets_section, head_offsets);
+        w.put(head_rules_section, head_rules);
+        w.put(closure_offsets_section, closure_offsets);
+        w.put(closure_symbols_section, closure);
+        w.put(corner_offsets_section, corner_offsets);
+        w.put(corner_heads_section, corner_heads);
+        w.header().symbols = symbols;
+        w.header().rules = rules;
+        return grammar(buf, &(*buf)[0], buf->size());
+    }
+
+    grammar read_grammar(std::istream& in) {
+        //read the whole file, then intern symbols straight from the buffer
+        std::vector<char> text;
+        char block[1 << 16];
+        while (in.read(block, sizeof(block)) || in.gcount())
+            text.insert(text.end(), block, block + in.gcount());
+        text.push_back('\0');
+
+        grammar_builder b;
+        std::vector<int> rhs;
+        char const* p = &text[0];
+        char const* end = p + text.size() - 1;
+        for(int line = 1; p < end; ++line) {
+            char const* eol = std::find(p, end, '\n');
+            while (p < eol && is_blank(*p)) ++p;
+            if (p == eol || *p == '#') {
+                p = eol + 1;
+                continue;
+            }
+
+            //optional weight
+            double weight = 1.0;
+            if (*p != '$') {
+                char* q;
+                weight = std::strtod(p, &q);
+                if (q == p || (q < eol && !is_blank(*q)))
+                    bad_line(line, "expected a weight or a non-terminal");
+                p = q;
+            }
+
+            //symbols: head --> rhs...
+            int head = -1;
+            bool arrow = false;
+            rhs.clear();
+            while (true) {
+                while (p < eol && is_blank(*p)) ++p;
+                if (p == eol) break;
+                char const* q = p;
+                while (q < eol && !is_blank(*q)) ++q;
+                if (head < 0) {
+                    if (*p != '$')
+                        bad_line(line, "rule head must be a non-terminal");
+                    head = b.symbol(p, q);
+                } else if (!arrow) {
+                    if (q - p != 3 || std::strncmp(p, "-->", 3))
+                        bad_line(line, "expected '-->'");
+                    arrow = true;
+                } else {
+                    rhs.push_back(b.symbol(p, q));
+                }
+                p = q;
+            }
+            if (!arrow)
+                bad_line(line, "expected '-->'");
+            b.add(head, rhs.empty() ? 0 : &rhs[0], rhs.size(), weight);
+            p = eol + 1;
+        }
+        return b.build();
+    }
+
+    grammar load_grammar(std::string const& path) {
+        std::ifstream in(path.c_str(), std::ios::binary);
+        if (!in)
+            throw std::runtime_error("cannot open grammar file: " + path);
+        char magic[sizeof(image_magic)] = { 0 };
+        in.read(magic, sizeof(magic));
+        if (in.gcount() == sizeof(magic) && !std::memcmp(magic, image_magic, sizeof(magic)))
+            return grammar::map(path);
+        in.clear();
+        in.seekg(0);
+        return read_grammar(in);
+    }
+}
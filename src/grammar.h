@@ -12,20 +12,34 @@
 
 #include "boost/lambda/lambda.hpp"
 #include "boost/lambda/bind.hpp"
+#include "boost/unordered_map.hpp"
+#include "boost/shared_ptr.hpp"
+#include "boost/cstdint.hpp"
 
 namespace jhi {
 
+    /**
+     * return true if the given symbol is a terminal (lexical token)
+     *
+     * non-terminal symbols start with '$'
+     */
+    inline bool is_terminal(std::string const& symbol) {
+        return symbol.empty() || '$' != symbol[0];
+    }
+
     /**
      * class rule
      *
      * encapsulates a rule in the grammar
-     * (allows up to three symbols on the right-hand side)
+     * (any number of symbols on the right-hand side, including none)
      */
     class rule {
         std::string _h;
         std::vector<std::string> _rhs;
 
         public:
+        explicit rule(std::string const& head)
+            : _h(head) {}
         rule(std::string const& head, std::string const& child) 
             : _h(head) {
                     _rhs.push_back(child);
@@ -41,6 +55,8 @@ namespace jhi {
                     _rhs.push_back(child2);
                     _rhs.push_back(child3);
                 }
+        rule(std::string const& head, std::vector<std::string> const& children)
+            : _h(head), _rhs(children) {}
 
         std::string const& head() const { return _h; }
         std::vector<std::string> const& rhs() const { return _rhs; }
@@ -49,12 +65,12 @@ namespace jhi {
          * return true if this rule takes a terminal (lexical token) on the right side
          */
         bool is_pos() const {
-            return '$' != rhs().front()[0];
+            return !rhs().empty() && is_terminal(rhs().front());
         }
 
         friend bool operator==(rule const& left, rule const& right) {
             return (left.head() == right.head())
-                && (std::equal(left.rhs().begin(), left.rhs().end(), right.rhs().begin()));
+                && (left.rhs() == right.rhs());
         }
 
         friend std::ostream& operator<<(std::ostream& out, rule const& r) {
@@ -66,31 +82,230 @@ namespace jhi {
         }
     };
 
+    /**
+     * a right-hand side or index entry of a compiled grammar: a run of ids
+     */
+    struct id_range {
+        int const* first;
+        int const* last;
+
+        id_range(int const* f, int const* l) : first(f), last(l) {}
+
+        int const* begin() const { return first; }
+        int const* end() const { return last; }
+        int size() const { return last - first; }
+        bool empty() const { return first == last; }
+        int front() const { return *first; }
+        int operator[](int i) const { return first[i]; }
+    };
+
+    /**
+     * a word of the input, viewed in place in text owned by the caller
+     */
+    struct token {
+        char const* text;
+        std::size_t length;
+
+        token(char const* t, std::size_t n) : text(t), length(n) {}
+        explicit token(std::string const& s) : text(s.data()), length(s.size()) {}
+
+        std::string str() const { return std::string(text, length); }
+
+        friend std::ostream& operator<<(std::ostream& out, token const& t) {
+            return out.write(t.text, t.length);
+        }
+    };
+
+    /**
+     * a rule of a compiled grammar: its head symbol and where its right-hand
+     * side starts in the grammar's symbol pool
+     */
+    struct rule_record {
+        boost::int32_t head;
+        boost::int32_t rhs;
+        boost::int32_t length;
+    };
+
+    class grammar_builder;
+
     /**
      * class grammar
      *
-     * contains rules and allows searching for rules with a given lhs symbol
+     * a compiled grammar: interned symbols, rules, and the indices used by the
+     * parser, all laid out in a single block of memory (the grammar image)
+     *
+     * the image is either owned by the grammar or a read-only mapping of a
+     * file written with save(), so a saved grammar can be used without being
+     * parsed or copied. grammars are cheap to copy; copies share the image.
+     *
+     * rules are identified by the order in which they were added,
+     * symbols by the order in which they first appeared
      */
     class grammar {
-        std::vector<rule> _rules;
+        boost::shared_ptr<void const> _storage;
+        char const* _image;
+        std::size_t _image_size;
+
+        int _symbol_count;
+        int _rule_count;
+        boost::uint32_t const* _symbol_offsets;
+        char const* _symbol_text;
+        boost::uint8_t const* _symbol_flags;
+        boost::int32_t const* _symbol_hash;
+        boost::uint32_t _symbol_hash_mask;
+        rule_record const* _rules;
+        boost::int32_t const* _rhs;
+        double const* _weights;
+        boost::uint32_t const* _head_offsets;
+        boost::int32_t const* _head_rules;
+        boost::uint32_t const* _closure_offsets;
+        boost::int32_t const* _closure_symbols;
+        boost::uint32_t const* _corner_offsets;
+        boost::int32_t const* _corner_heads;
+
+        friend class grammar_builder;
+        grammar(boost::shared_ptr<void const> storage, char const* image, std::size_t size);
 
         public:
-        grammar(std::vector<rule> const& rules) : _rules(rules) {}
+        /** properties recorded for each symbol */
+        enum symbol_flag {
+            terminal_flag = 1,
+            nullable_flag = 2  //derives the empty string
+        };
+
+        grammar(std::vector<rule> const& rules);
 
         /**
-         * get rules that create the given symbol
+         * use a grammar image written by save() in place
+         *
+         * throws std::runtime_error if the file is not a grammar image, or
+         * if any index or id in it is out of range
          */
-        std::vector<rule> rules_with_head(std::string const& head) const
+        static grammar map(std::string const& path);
+
+        /** write the grammar image */
+        void save(std::ostream& out) const;
+
+        /* symbols */
+        int symbol_count() const { return _symbol_count; }
+        char const* name(int symbol) const { return _symbol_text + _symbol_offsets[symbol]; }
+        bool terminal(int symbol) const { return _symbol_flags[symbol] & terminal_flag; }
+        bool nullable(int symbol) const { return _symbol_flags[symbol] & nullable_flag; }
+
+        /**
+         * return the id of the named symbol, or -1 if it is not in the grammar
+         */
+        int find(char const* name, std::size_t length) const;
+        int find(std::string const& name) const { return find(name.data(), name.size()); }
+        int find(token const& word) const { return find(word.text, word.length); }
+
+        /* rules */
+        int size() const { return _rule_count; }
+        int head(int r) const { return _rules[r].head; }
+        int length(int r) const { return _rules[r].length; }
+        id_range rhs(int r) const {
+            return id_range(_rhs + _rules[r].rhs, _rhs + _rules[r].rhs + _rules[r].length);
+        }
+        double weight(int r) const { return _weights[r]; }
+
+        /** return rule `r` with its symbols spelled out */
+        rule operator[](int r) const;
+
+        /** write rule `r` in the form "$head --> rhs..." */
+        void write_rule(std::ostream& out, int r) const;
+
+        /**
+         * get the ids of the rules that create the given symbol
+         */
+        id_range rules_for(int symbol) const {
+            return id_range(_head_rules + _head_offsets[symbol],
+                    _head_rules + _head_offsets[symbol + 1]);
+        }
+
+        /**
+         * get the non-terminals to predict when the given symbol is expected:
+         * the symbol and every non-terminal that can start it (possibly after
+         * nullable symbols)
+         */
+        id_range closure(int symbol) const {
+            return id_range(_closure_symbols + _closure_offsets[symbol],
+                    _closure_symbols + _closure_offsets[symbol + 1]);
+        }
+
+        /**
+         * get the non-terminals with a rule that can start with the given
+         * symbol (possibly after nullable symbols); the inverse of the
+         * left-corner relation, used to filter predictions by the next word
+         */
+        id_range left_corner_parents(int symbol) const {
+            return id_range(_corner_heads + _corner_offsets[symbol],
+                    _corner_heads + _corner_offsets[symbol + 1]);
+        }
+
+        /**
+         * get the ids of the rules that create the given symbol
+         */
+        id_range rules_with_head(std::string const& head) const
         {
-            using namespace boost::lambda;
-            std::vector<rule> ret;
-            std::remove_copy_if(_rules.begin(), _rules.end(), std::back_inserter(ret),
-                    bind(std::not_equal_to<std::string>(), head, bind(&rule::head, _1))
-                    );
-            return ret;
+            int h = find(head);
+            return h < 0 ? id_range(_head_rules, _head_rules) : rules_for(h);
+        }
+    };
+
+    /**
+     * class grammar_builder
+     *
+     * collects rules, interning their symbols, and compiles them into a grammar
+     */
+    class grammar_builder {
+        boost::unordered_map<std::string, int> _ids;
+        std::vector<std::string> _names;
+        std::vector<rule_record> _rules;
+        std::vector<int> _rhs;
+        std::vector<double> _weights;
+        std::string _key;
+
+        public:
+        /**
+         * return the id of the named symbol, adding it if it is new
+         */
+        int symbol(std::string const& name);
+        int symbol(char const* begin, char const* end) {
+            _key.assign(begin, end);
+            return symbol(_key);
         }
+
+        /**
+         * add a rule with the given head and right-hand side symbol ids,
+         * returning the new rule's id
+         */
+        int add(int head, int const* rhs, int length, double weight = 1.0);
+        int add(rule const& r, double weight = 1.0);
+
+        /** number of rules added so far */
+        int size() const { return _rules.size(); }
+
+        grammar build() const;
     };
 
+    /**
+     * read a grammar in text form: one rule per line, optionally preceded by
+     * its weight (1 if omitted); blank lines and lines starting with '#' are
+     * skipped
+     *
+     *     0.75    $np --> $det $noun
+     *             $det --> the
+     *
+     * throws std::runtime_error on a malformed line
+     */
+    grammar read_grammar(std::istream& in);
+
+    /**
+     * load a grammar file, mapping it if it is a grammar image and
+     * reading it as text otherwise
+     */
+    grammar load_grammar(std::string const& path);
+
     /*
      *
      * (a) sentence --> np, vp.
@@ -0,0 +1,282 @@
+//      Copyright Joseph Irwin <joseph.irwin.gt@gmail.com>
+// Distributed under the Boost Software License, Version 1.0.
+//            http://www.boost.org/LICENSE_1_0.txt
+
+#include "inside_outside.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include "boost/thread.hpp"
+
+namespace {
+
+    /**
+     * order the items of a set so that each item comes after the items
+     * of the same set it was derived from
+     */
+    std::vector<int> topological_order(jhi::chart const& c, int set) {
+        int n = c[set].size();
+        std::vector<char> state(n, 0); //0: unvisited, 1: on stack, 2: done
+        std::vector<int> order;
+        order.reserve(n);
+        std::vector<std::pair<int, int> > stack; //item, next edge to follow
+
+        for(int root = 0; root < n; ++root) {
+            if (state[root]) continue;
+            state[root] = 1;
+            stack.push_back(std::make_pair(root, 0));
+            while (!stack.empty()) {
+                int i = stack.back().first;
+                jhi::chart::back_pointer_range bps = c.back_pointers(set, i);
+                if (stack.back().second < 2 * bps.size()) {
+                    //each back pointer has two edges: the child and the predecessor
+                    int e = stack.back().second++;
+                    jhi::back_pointer const& bp = bps[e / 2];
+                    int next = bp.leo() ? -1
+                        : e % 2 == 0 ? bp.child : (bp.pred_set == set ? bp.pred : -1);
+                    if (next >= 0 && !state[next]) {
+                        state[next] = 1;
+                        stack.push_back(std::make_pair(next, 0));
+                    }
+                } else {
+                    state[i] = 2;
+                    order.push_back(i);
+                    stack.pop_back();
+                }
+            }
+        }
+        return order;
+    }
+
+    /**
+     * true if the back pointer closes a cycle within the set, pointing at an
+     * item that does not come before item `i` in the topological order
+     */
+    bool cycle_edge(std::vector<int> const& rank, int set, int i, jhi::back_pointer const& bp) {
+        return (bp.child >= 0 && rank[bp.child] >= rank[i])
+            || (bp.pred_set == set && rank[bp.pred] >= rank[i]);
+    }
+
+    /**
+     * log(exp(a) + exp(b)), without leaving the log domain
+     */
+    double log_add(double a, double b) {
+        if (a < b)
+            std::swap(a, b);
+        if (b == -std::numeric_limits<double>::infinity())
+            return a;
+        return a + std::log(1.0 + std::exp(b - a));
+    }
+
+    /**
+     * accumulates expected counts for one worker's share of the corpus
+     *
+     * the corpus is cut into blocks of `block` sentences, dealt out to workers in turn
+     */
+    struct em_worker {
+        jhi::grammar const* g;
+        std::string const* start;
+        jhi::sentence_vector const* corpus;
+        jhi::rule_weights const* weights;
+        int worker;
+        int workers;
+        int block;
+        jhi::parser_context* context;
+        jhi::rule_weights* counts;
+        double* log_likelihood;
+        int* unparsed;
+
+        void operator()() const {
+            double ll = 0;
+            int missed = 0;
+            int n = corpus->size();
+            for(int b = worker * block; b < n; b += workers * block) {
+                int e = std::min(n, b + block);
+                for(int i = b; i < e; ++i) {
+                    double p = jhi::inside_outside(*context, *g, *weights, *start, (*corpus)[i], *counts);
+                    if (p > -std::numeric_limits<double>::infinity())
+                        ll += p;
+                    else
+                        ++missed;
+                }
+            }
+            *log_likelihood = ll;
+            *unparsed = missed;
+        }
+    };
+}
+
+namespace jhi {
+
+    rule_weights uniform_weights(jhi::grammar const& g) {
+        rule_weights w(g.size());
+        for(int i = 0; i < g.size(); ++i)
+            w[i] = 1.0 / g.rules_for(g.head(i)).size();
+        return w;
+    }
+
+    double inside_outside(
+            jhi::grammar const& g,
+            rule_weights const& weights,
+            std::string const& start_symbol,
+            chart const& c,
+            rule_weights& counts)
+    {
+        //inside and outside probabilities are kept as logs, so they stay in
+        //range however long the sentence
+        int last = c.size() - 1;
+        double const zero = -std::numeric_limits<double>::infinity();
+        rule_weights log_weights(weights.size());
+        for(int r = 0; r < weights.size(); ++r)
+            log_weights[r] = weights[r] > 0 ? std::log(weights[r]) : zero;
+        std::vector<std::vector<int> > order(c.size());
+        std::vector<std::vector<int> > rank(c.size());
+        std::vector<std::vector<double> > inside(c.size());
+
+        //inside pass
+        for(int s = 0; s < c.size(); ++s) {
+            order[s] = topological_order(c, s);
+            rank[s].resize(c[s].size());
+            for(int k = 0; k < order[s].size(); ++k)
+                rank[s][order[s][k]] = k;
+            inside[s].assign(c[s].size(), zero);
+            for(int k = 0; k < order[s].size(); ++k) {
+                int i = order[s][k];
+                if (c[s][i].dot == 0) {
+                    inside[s][i] = 0.0;
+                    continue;
+                }
+                double sum = zero;
+                chart::back_pointer_range bps = c.back_pointers(s, i);
+                for(int b = 0; b < bps.size(); ++b) {
+                    if (bps[b].leo()) continue; //not part of any parse
+                    if (cycle_edge(rank[s], s, i, bps[b])) continue;
+                    double child = bps[b].child < 0 ? 0.0
+                        : inside[s][bps[b].child] + log_weights[c[s][bps[b].child].rule];
+                    sum = log_add(sum, inside[bps[b].pred_set][bps[b].pred] + child);
+                }
+                inside[s][i] = sum;
+            }
+        }
+
+        std::vector<int> goals(goal_items(g, start_symbol, c));
+        double z = zero;
+        for(int i = 0; i < goals.size(); ++i)
+            z = log_add(z, inside[last][goals[i]] + log_weights[c[last][goals[i]].rule]);
+        if (z == zero)
+            return zero;
+
+        //outside pass
+        std::vector<std::vector<double> > outside(c.size());
+        for(int s = 0; s < c.size(); ++s)
+            outside[s].assign(c[s].size(), zero);
+        for(int i = 0; i < goals.size(); ++i)
+            outside[last][goals[i]] = log_add(outside[last][goals[i]], log_weights[c[last][goals[i]].rule]);
+
+        for(int s = last; s >= 0; --s) {
+            for(int k = order[s].size() - 1; k >= 0; --k) {
+                int i = order[s][k];
+                double a = outside[s][i];
+                if (a == zero) continue;
+                chart::back_pointer_range bps = c.back_pointers(s, i);
+                for(int b = 0; b < bps.size(); ++b) {
+                    back_pointer const& bp = bps[b];
+                    double& pred = outside[bp.pred_set][bp.pred];
+                    if (bp.leo() || cycle_edge(rank[s], s, i, bp)) {
+                        continue;
+                    } else if (bp.child < 0) {
+                        pred = log_add(pred, a);
+                    } else {
+                        double w = log_weights[c[s][bp.child].rule];
+                        pred = log_add(pred, a + inside[s][bp.child] + w);
+                        outside[s][bp.child] = log_add(outside[s][bp.child],
+                                a + inside[bp.pred_set][bp.pred] + w);
+                    }
+                }
+            }
+        }
+
+        //expected rule counts
+        for(int s = 0; s < c.size(); ++s)
+            for(int i = 0; i < c[s].size(); ++i)
+                if (complete(g, c[s][i]) && outside[s][i] > zero && inside[s][i] > zero)
+                    counts[c[s][i].rule] += std::exp(outside[s][i] + inside[s][i] - z);
+
+        return z;
+    }
+
+    double inside_outside(
+            jhi::grammar const& g,
+            rule_weights const& weights,
+            std::string const& start_symbol,
+            std::vector<std::string> const& input,
+            rule_weights& counts)
+    {
+        return inside_outside(g, weights, start_symbol,
+                recognize(g, start_symbol, input), counts);
+    }
+
+    double inside_outside(
+            parser_context& context,
+            jhi::grammar const& g,
+            rule_weights const& weights,
+            std::string const& start_symbol,
+            std::vector<std::string> const& input,
+            rule_weights& counts)
+    {
+        return inside_outside(g, weights, start_symbol,
+                recognize(context, g, start_symbol, input), counts);
+    }
+
+    double em_trainer::iterate(sentence_vector const& corpus, rule_weights& weights, int* unparsed) const
+    {
+        //expectation: each worker fills its own count buffer, recognizing
+        //its sentences with its own context
+        std::vector<rule_weights> counts(_threads, rule_weights(_g.size(), 0.0));
+        std::vector<double> ll(_threads, 0.0);
+        std::vector<int> missed(_threads, 0);
+        std::vector<parser_context> contexts(_threads);
+        std::vector<em_worker> workers(_threads);
+        for(int t = 0; t < _threads; ++t) {
+            em_worker w = { &_g, &_start, &corpus, &weights,
+                t, _threads, 64, &contexts[t], &counts[t], &ll[t], &missed[t] };
+            workers[t] = w;
+        }
+        if (_threads == 1) {
+            workers[0]();
+        } else {
+            boost::thread_group group;
+            for(int t = 0; t < _threads; ++t)
+                group.create_thread(workers[t]);
+            group.join_all();
+        }
+
+        //merge
+        double log_likelihood = 0;
+        if (unparsed)
+            *unparsed = 0;
+        for(int t = 0; t < _threads; ++t) {
+            log_likelihood += ll[t];
+            if (unparsed)
+                *unparsed += missed[t];
+            if (t > 0)
+                for(int r = 0; r < _g.size(); ++r)
+                    counts[0][r] += counts[t][r];
+        }
+
+        //maximization: normalize counts over rules with the same head
+        //(totals are kept at the id of the first rule with each head)
+        rule_weights const& total = counts[0];
+        std::vector<int> first(_g.size());
+        std::vector<double> head_total(_g.size(), 0.0);
+        for(int r = 0; r < _g.size(); ++r) {
+            first[r] = _g.rules_for(_g.head(r)).front();
+            head_total[first[r]] += total[r];
+        }
+        for(int r = 0; r < _g.size(); ++r)
+            if (head_total[first[r]] > 0)
+                weights[r] = total[r] / head_total[first[r]];
+        return log_likelihood;
+    }
+}
@@ -0,0 +1,104 @@
+//      Copyright Joseph Irwin <joseph.irwin.gt@gmail.com>
+// Distributed under the Boost Software License, Version 1.0.
+//            http://www.boost.org/LICENSE_1_0.txt
+
+#ifndef __PARSER__INSIDE_OUTSIDE_H__
+#define __PARSER__INSIDE_OUTSIDE_H__
+
+#include "chart.h"
+
+namespace jhi {
+
+    /**
+     * a weight (probability) for each rule in a grammar, indexed by rule id
+     */
+    typedef std::vector<double> rule_weights;
+
+    /**
+     * a corpus of tokenized sentences
+     */
+    typedef std::vector<std::vector<std::string> > sentence_vector;
+
+    /**
+     * return weights giving each rule an equal share of the probability of its head
+     */
+    rule_weights uniform_weights(jhi::grammar const& g);
+
+    /**
+     * inside_outside
+     *
+     * runs the inside and outside passes over a filled chart and adds the expected
+     * number of uses of each rule to `counts`
+     *
+     * returns the log of the inside probability of the sentence, or minus
+     * infinity if it has no parse (in which case `counts` is left unchanged);
+     * the passes work with log probabilities, so long sentences do not
+     * underflow
+     *
+     * a unary cycle gives infinitely many derivations; each cycle in the chart
+     * is cut at one edge so the sums stay finite, and derivations through the
+     * cut edge are not counted
+     */
+    double inside_outside(
+            jhi::grammar const& g,
+            rule_weights const& weights,
+            std::string const& start_symbol,
+            chart const& c,
+            rule_weights& counts);
+
+    /**
+     * inside_outside
+     *
+     * parses the input and runs the inside and outside passes over its chart
+     */
+    double inside_outside(
+            jhi::grammar const& g,
+            rule_weights const& weights,
+            std::string const& start_symbol,
+            std::vector<std::string> const& input,
+            rule_weights& counts);
+
+    /**
+     * inside_outside
+     *
+     * parses the input with the context's chart, which is reused from one
+     * sentence to the next
+     */
+    double inside_outside(
+            parser_context& context,
+            jhi::grammar const& g,
+            rule_weights const& weights,
+            std::string const& start_symbol,
+            std::vector<std::string> const& input,
+            rule_weights& counts);
+
+    /**
+     * class em_trainer
+     *
+     * estimates rule weights from unannotated sentences with the
+     * expectation-maximization algorithm
+     *
+     * the corpus is split between `threads` workers; each worker keeps its own
+     * expected counts, which are merged once per iteration
+     */
+    class em_trainer {
+            jhi::grammar const& _g;
+            std::string _start;
+            int _threads;
+        public:
+            em_trainer(jhi::grammar const& g, std::string const& start_symbol, int threads = 1)
+                : _g(g), _start(start_symbol), _threads(threads < 1 ? 1 : threads) {}
+
+            /**
+             * run one iteration, replacing `weights` with the re-estimated weights
+             *
+             * returns the log-likelihood of the corpus under the old weights;
+             * sentences without a parse are skipped, and their number stored
+             * in `unparsed` if it is given
+             */
+            double iterate(sentence_vector const& corpus, rule_weights& weights, int* unparsed = 0) const;
+    };
+
+}//namespace jhi
+
+#endif //__PARSER__INSIDE_OUTSIDE_H__
@@ -0,0 +1,205 @@
+//      Copyright Joseph Irwin <joseph.irwin.gt@gmail.com>
+// Distributed under the Boost Software License, Version 1.0.
+//            http://www.boost.org/LICENSE_1_0.txt
+
+#include "lr0.h"
+
+#include "boost/unordered_set.hpp"
+
+namespace {
+
+    typedef std::pair<int, int> dotted_rule; //(rule, dot)
+    typedef std::vector<dotted_rule> item_set;
+
+    /**
+     * advance every dotted rule of the set over nullable symbols
+     */
+    void skip_nullable(jhi::grammar const& g, item_set& items) {
+        boost::unordered_set<dotted_rule> seen(items.begin(), items.end());
+        for(int i = 0; i < items.size(); ++i) {
+            dotted_rule dr = items[i];
+            if (dr.second < g.length(dr.first) && g.nullable(g.rhs(dr.first)[dr.second])) {
+                ++dr.second;
+                if (seen.insert(dr).second)
+                    items.push_back(dr);
+            }
+        }
+        std::sort(items.begin(), items.end());
+    }
+
+    /**
+     * the rules predicted by the given symbols, advanced over nullable symbols
+     */
+    item_set predictions(jhi::grammar const& g, std::vector<int> const& symbols) {
+        std::vector<bool> predicted(g.symbol_count());
+        item_set items;
+        for(int i = 0; i < symbols.size(); ++i) {
+            jhi::id_range closure = g.closure(symbols[i]);
+            for(int const* c = closure.begin(); c != closure.end(); ++c) {
+                if (predicted[*c])
+                    continue;
+                predicted[*c] = true;
+                jhi::id_range rules = g.rules_for(*c);
+                for(int const* r = rules.begin(); r != rules.end(); ++r)
+                    items.push_back(dotted_rule(*r, 0));
+            }
+        }
+        skip_nullable(g, items);
+        return items;
+    }
+
+    /**
+     * builds the automaton states breadth-first
+     *
+     * kernel and prediction states are kept apart even when they hold the
+     * same dotted rules, since only kernel states have a prediction state
+     */
+    struct builder {
+        typedef std::pair<bool, item_set> state_key; //(kernel, items)
+
+        jhi::grammar const& g;
+        boost::unordered_map<state_key, int> ids;
+        std::vector<state_key> states;
+
+        builder(jhi::grammar const& g) : g(g) {}
+
+        int state(bool kernel, item_set const& items) {
+            if (items.empty())
+                return -1;
+            state_key k(kernel, items);
+            boost::unordered_map<state_key, int>::const_iterator it = ids.find(k);
+            if (it != ids.end())
+                return it->second;
+            ids.insert(std::make_pair(k, int(states.size())));
+            states.push_back(k);
+            return states.size() - 1;
+        }
+    };
+
+    /**
+     * add an item to a set, then the item for its prediction state
+     */
+    void add(jhi::lr0_automaton const& a,
+            std::vector<jhi::lr0_item>& set,
+            boost::unordered_set<jhi::lr0_item>& seen,
+            int state, int origin, int i)
+    {
+        if (state < 0 || !seen.insert(jhi::lr0_item(state, origin)).second)
+            return;
+        set.push_back(jhi::lr0_item(state, origin));
+        int p = a.predict(state);
+        if (p >= 0 && seen.insert(jhi::lr0_item(p, i)).second)
+            set.push_back(jhi::lr0_item(p, i));
+    }
+
+}//namespace
+
+namespace jhi {
+
+    lr0_automaton::lr0_automaton(jhi::grammar const& g, std::string const& start_symbol)
+        : _start(-1), _start_symbol(g.find(start_symbol))
+    {
+        _completed_offsets.push_back(0);
+        if (_start_symbol < 0)
+            return;
+
+        builder b(g);
+        _start = b.state(false, predictions(g, std::vector<int>(1, _start_symbol)));
+        if (_start < 0)
+            return;
+
+        for(int s = 0; s < b.states.size(); ++s) {
+            //copy: adding states may reallocate
+            bool kernel = b.states[s].first;
+            item_set items = b.states[s].second;
+
+            //group the advanced rules by the symbol they advance over
+            std::vector<std::pair<int, dotted_rule> > next;
+            std::vector<int> heads;
+            for(int i = 0; i < items.size(); ++i) {
+                int r = items[i].first, d = items[i].second;
+                if (d < g.length(r))
+                    next.push_back(std::make_pair(g.rhs(r)[d], dotted_rule(r, d + 1)));
+                else
+                    heads.push_back(g.head(r));
+            }
+            std::sort(next.begin(), next.end());
+            std::vector<int> awaited;
+            for(int i = 0; i < next.size(); ) {
+                int symbol = next[i].first;
+                item_set advanced;
+                for(; i < next.size() && next[i].first == symbol; ++i)
+                    advanced.push_back(next[i].second);
+                skip_nullable(g, advanced);
+                _goto[key(s, symbol)] = b.state(true, advanced);
+                if (!g.terminal(symbol))
+                    awaited.push_back(symbol);
+            }
+
+            _predict.push_back(kernel ? b.state(false, predictions(g, awaited)) : -1);
+
+            std::sort(heads.begin(), heads.end());
+            heads.erase(std::unique(heads.begin(), heads.end()), heads.end());
+            _completed.insert(_completed.end(), heads.begin(), heads.end());
+            _completed_offsets.push_back(_completed.size());
+            _items.push_back(items.size());
+        }
+        //keep &_completed[0] valid when no state completes anything
+        _completed.push_back(-1);
+    }
+
+    bool lr0_automaton::accepts(int state) const {
+        id_range heads = completed(state);
+        return std::binary_search(heads.begin(), heads.end(), _start_symbol);
+    }
+
+    lr0_chart lr0_recognize(
+            jhi::grammar const& g,
+            jhi::lr0_automaton const& a,
+            std::vector<std::string> const& input)
+    {
+        lr0_chart c(input.size() + 1);
+        if (a.start() < 0)
+            return c;
+
+        std::vector<int> words(input.size());
+        for(int i = 0; i < input.size(); ++i)
+            words[i] = g.find(input[i]);
+
+        boost::unordered_set<lr0_item> seen, next;
+        c[0].push_back(lr0_item(a.start(), 0));
+        seen.insert(c[0].back());
+        for(int i = 0; i < c.size(); ++i) {
+            std::vector<lr0_item>& set = c[i];
+            for(int j = 0; j < set.size(); ++j) {
+                lr0_item const it = set[j];
+
+                //complete; empty spans were folded into the states
+                if (it.origin < i) {
+                    id_range heads = a.completed(it.state);
+                    for(int const* h = heads.begin(); h != heads.end(); ++h) {
+                        std::vector<lr0_item> const& parents = c[it.origin];
+                        for(int k = 0; k < parents.size(); ++k)
+                            add(a, set, seen, a.go(parents[k].state, *h), parents[k].origin, i);
+                    }
+                }
+
+                //scan
+                if (i < words.size() && words[i] >= 0)
+                    add(a, c[i + 1], next, a.go(it.state, words[i]), it.origin, i + 1);
+            }
+            seen.swap(next);
+            next.clear();
+        }
+        return c;
+    }
+
+    bool accepted(jhi::lr0_automaton const& a, jhi::lr0_chart const& c) {
+        std::vector<lr0_item> const& last = c.back();
+        for(int i = 0; i < last.size(); ++i)
+            if (last[i].origin == 0 && a.accepts(last[i].state))
+                return true;
+        return false;
+    }
+
+}//namespace jhi
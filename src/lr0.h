@@ -0,0 +1,115 @@
+//      Copyright Joseph Irwin <joseph.irwin.gt@gmail.com>
+// Distributed under the Boost Software License, Version 1.0.
+//            http://www.boost.org/LICENSE_1_0.txt
+
+#ifndef __PARSER__LR0_H__
+#define __PARSER__LR0_H__
+
+#include "grammar.h"
+
+#include "boost/functional/hash.hpp"
+
+namespace jhi {
+
+    /**
+     * class lr0_automaton
+     *
+     * the split LR(0) automaton of a grammar for a start symbol, with nullable
+     * symbols folded into its states (Aycock and Horspool's epsilon-DFA)
+     *
+     * each state is a set of dotted rules; a kernel state holds the rules that
+     * advanced over a symbol, and its prediction state holds the rules it
+     * predicts. rules sharing a prefix share states, so an Earley set of
+     * (state, origin) items holds far fewer items than one of dotted rules.
+     *
+     * built once per grammar and start symbol; read-only afterwards, so one
+     * automaton can be shared by many threads
+     */
+    class lr0_automaton {
+            typedef boost::unordered_map<boost::uint64_t, int> goto_type;
+
+            int _start;
+            int _start_symbol;
+            goto_type _goto;
+            std::vector<int> _predict;
+            std::vector<int> _completed_offsets;
+            std::vector<int> _completed;
+            std::vector<int> _items; //number of dotted rules in each state
+
+            static boost::uint64_t key(int state, int symbol) {
+                return (boost::uint64_t(state) << 32) | boost::uint32_t(symbol);
+            }
+        public:
+            lr0_automaton(jhi::grammar const& g, std::string const& start_symbol);
+
+            /** number of states */
+            int size() const { return _predict.size(); }
+
+            /** the initial state, or -1 if the start symbol is not in the grammar */
+            int start() const { return _start; }
+
+            /** the state reached from `state` over `symbol`, or -1 */
+            int go(int state, int symbol) const {
+                goto_type::const_iterator it = _goto.find(key(state, symbol));
+                return it == _goto.end() ? -1 : it->second;
+            }
+
+            /** the prediction state of a kernel state, or -1 */
+            int predict(int state) const { return _predict[state]; }
+
+            /** the heads of the rules completed in the state */
+            id_range completed(int state) const {
+                return id_range(&_completed[0] + _completed_offsets[state],
+                        &_completed[0] + _completed_offsets[state + 1]);
+            }
+
+            /** true if the state completes the start symbol */
+            bool accepts(int state) const;
+
+            /** number of dotted rules in the state */
+            int items(int state) const { return _items[state]; }
+    };
+
+    /**
+     * an item of the LR(0) Earley recognizer: an automaton state and the
+     * input position its rules started at
+     */
+    struct lr0_item {
+        int state;
+        int origin;
+
+        lr0_item(int s, int o) : state(s), origin(o) {}
+
+        friend bool operator==(lr0_item const& left, lr0_item const& right) {
+            return left.state == right.state && left.origin == right.origin;
+        }
+
+        friend std::size_t hash_value(lr0_item const& i) {
+            std::size_t seed = 0;
+            boost::hash_combine(seed, i.state);
+            boost::hash_combine(seed, i.origin);
+            return seed;
+        }
+    };
+
+    typedef std::vector<std::vector<lr0_item> > lr0_chart;
+
+    /**
+     * lr0_recognize
+     *
+     * runs the Earley recognizer over automaton states, returning its sets
+     * (recognition only; use recognize() for parse trees)
+     */
+    lr0_chart lr0_recognize(
+            jhi::grammar const& g,
+            lr0_automaton const& a,
+            std::vector<std::string> const& input);
+
+    /**
+     * return true if the chart holds a complete parse of the input
+     */
+    bool accepted(lr0_automaton const& a, lr0_chart const& c);
+
+}//namespace jhi
+
+#endif //__PARSER__LR0_H__
@@ -0,0 +1,262 @@
+//      Copyright Joseph Irwin <joseph.irwin.gt@gmail.com>
+// Distributed under the Boost Software License, Version 1.0.
+//            http://www.boost.org/LICENSE_1_0.txt
+
+#include "optimize.h"
+
+namespace {
+
+    /**
+     * a right-hand side (in builder symbol ids) and its weight
+     */
+    struct weighted_rhs {
+        std::vector<int> rhs;
+        double weight;
+    };
+
+    /**
+     * copies rules into a builder, keeping the names of the symbols it adds
+     * and left-factoring the rules of a head on request
+     */
+    class rule_writer {
+            jhi::grammar const& _g;
+            jhi::grammar_builder& _b;
+            std::vector<std::string> _names; //indexed by builder symbol id
+            std::vector<std::string>& _added;
+        public:
+            rule_writer(jhi::grammar const& g, jhi::grammar_builder& b, std::vector<std::string>& added)
+                : _g(g), _b(b), _added(added) {}
+
+            int symbol(std::string const& name) {
+                int id = _b.symbol(name);
+                if (id == _names.size())
+                    _names.push_back(name);
+                return id;
+            }
+
+            /** builder id of a symbol of the original grammar */
+            int symbol_of(int original) { return symbol(_g.name(original)); }
+
+            void add(int head, std::vector<int> const& rhs, double weight) {
+                _b.add(head, rhs.empty() ? 0 : &rhs[0], rhs.size(), weight);
+            }
+
+            /**
+             * add the rules of `head`, grouped by first symbol; a group of
+             * several rules becomes one rule for the longest common prefix
+             * followed by a new non-terminal deriving the rest of each rule
+             *
+             * `base` names the new non-terminals: the original head and the
+             * prefix factored out of it so far, joined by '|' so the names
+             * hold no blanks and survive write_rule() and read_grammar()
+             */
+            void factor(int head, std::string const& base, std::vector<weighted_rhs> const& rules) {
+                std::vector<bool> done(rules.size());
+                for(int i = 0; i < rules.size(); ++i) {
+                    if (done[i])
+                        continue;
+                    std::vector<int> group(1, i);
+                    for(int j = i + 1; j < rules.size(); ++j)
+                        if (!done[j] && !rules[i].rhs.empty() && !rules[j].rhs.empty()
+                                && rules[j].rhs[0] == rules[i].rhs[0])
+                            group.push_back(j);
+                    for(int k = 0; k < group.size(); ++k)
+                        done[group[k]] = true;
+                    if (group.size() == 1) {
+                        add(head, rules[i].rhs, rules[i].weight);
+                        continue;
+                    }
+
+                    //longest prefix common to the group
+                    std::vector<int> const& first = rules[i].rhs;
+                    int prefix = first.size();
+                    double total = 0;
+                    for(int k = 0; k < group.size(); ++k) {
+                        std::vector<int> const& rhs = rules[group[k]].rhs;
+                        int p = 0;
+                        while (p < prefix && p < rhs.size() && rhs[p] == first[p])
+                            ++p;
+                        prefix = p;
+                        total += rules[group[k]].weight;
+                    }
+
+                    std::string name = base;
+                    for(int p = 0; p < prefix; ++p)
+                        name += "|" + _names[first[p]];
+                    //a name not already used by the grammar
+                    std::string unique = name;
+                    int factored = -1;
+                    for( ; ; unique += "'") {
+                        int before = _names.size();
+                        if (_g.find(unique) < 0 && (factored = symbol(unique)) == before)
+                            break;
+                    }
+                    _added.push_back(unique);
+
+                    std::vector<int> rhs(first.begin(), first.begin() + prefix);
+                    rhs.push_back(factored);
+                    add(head, rhs, total);
+
+                    std::vector<weighted_rhs> rest(group.size());
+                    for(int k = 0; k < group.size(); ++k) {
+                        weighted_rhs const& r = rules[group[k]];
+                        rest[k].rhs.assign(r.rhs.begin() + prefix, r.rhs.end());
+                        rest[k].weight = total > 0 ? r.weight / total : r.weight;
+                    }
+                    factor(factored, name, rest);
+                }
+            }
+    };
+
+    void write_rules(std::ostream& out, jhi::grammar const& g,
+            char const* what, std::vector<int> const& rules)
+    {
+        for(int i = 0; i < rules.size(); ++i) {
+            out << what;
+            g.write_rule(out, rules[i]);
+            out << "\n";
+        }
+    }
+
+}//namespace
+
+namespace jhi {
+
+    grammar optimize_grammar(
+            grammar const& g,
+            std::string const& start_symbol,
+            bool left_factor,
+            grammar_report* report)
+    {
+        grammar_report local;
+        grammar_report& rep = report ? *report : local;
+        rep = grammar_report();
+        int symbols = g.symbol_count();
+        int rules = g.size();
+
+        //productive symbols: count the non-terminals of each rule not yet
+        //known to be productive, and mark a head productive when one of its
+        //rules reaches zero
+        std::vector<bool> productive(symbols);
+        std::vector<int> left(rules, 0);
+        std::vector<std::vector<int> > used_by(symbols);
+        std::vector<int> work;
+        for(int s = 0; s < symbols; ++s)
+            productive[s] = g.terminal(s);
+        for(int r = 0; r < rules; ++r) {
+            id_range rhs = g.rhs(r);
+            for(int i = 0; i < rhs.size(); ++i) {
+                if (!g.terminal(rhs[i])) {
+                    ++left[r];
+                    used_by[rhs[i]].push_back(r);
+                }
+            }
+            if (left[r] == 0 && !productive[g.head(r)]) {
+                productive[g.head(r)] = true;
+                work.push_back(g.head(r));
+            }
+        }
+        while (!work.empty()) {
+            int s = work.back();
+            work.pop_back();
+            for(int i = 0; i < used_by[s].size(); ++i) {
+                int r = used_by[s][i];
+                if (--left[r] == 0 && !productive[g.head(r)]) {
+                    productive[g.head(r)] = true;
+                    work.push_back(g.head(r));
+                }
+            }
+        }
+        std::vector<bool> keep(rules, true);
+        for(int r = 0; r < rules; ++r) {
+            id_range rhs = g.rhs(r);
+            for(int i = 0; i < rhs.size() && keep[r]; ++i)
+                keep[r] = productive[rhs[i]];
+            keep[r] = keep[r] && productive[g.head(r)];
+            if (!keep[r])
+                rep.nonproductive.push_back(r);
+        }
+
+        //symbols reachable from the start symbol through the remaining rules
+        std::vector<bool> reached(symbols);
+        int start = g.find(start_symbol);
+        if (start >= 0) {
+            reached[start] = true;
+            work.assign(1, start);
+        }
+        while (!work.empty()) {
+            id_range expansions = g.rules_for(work.back());
+            work.pop_back();
+            for(int k = 0; k < expansions.size(); ++k) {
+                if (!keep[expansions[k]])
+                    continue;
+                id_range rhs = g.rhs(expansions[k]);
+                for(int i = 0; i < rhs.size(); ++i) {
+                    if (!reached[rhs[i]]) {
+                        reached[rhs[i]] = true;
+                        work.push_back(rhs[i]);
+                    }
+                }
+            }
+        }
+        for(int r = 0; r < rules; ++r) {
+            if (keep[r] && !reached[g.head(r)]) {
+                keep[r] = false;
+                rep.unreachable.push_back(r);
+            }
+        }
+
+        //merge duplicates into the first copy of each rule
+        std::vector<double> weights(rules);
+        boost::unordered_map<std::vector<int>, int> first;
+        for(int r = 0; r < rules; ++r) {
+            weights[r] = g.weight(r);
+            if (!keep[r])
+                continue;
+            std::vector<int> key(1, g.head(r));
+            key.insert(key.end(), g.rhs(r).begin(), g.rhs(r).end());
+            std::pair<boost::unordered_map<std::vector<int>, int>::iterator, bool> f
+                = first.insert(std::make_pair(key, r));
+            if (!f.second) {
+                weights[f.first->second] += weights[r];
+                keep[r] = false;
+                rep.duplicates.push_back(r);
+            }
+        }
+
+        grammar_builder b;
+        rule_writer w(g, b, rep.factored);
+        if (start >= 0)
+            w.symbol(start_symbol);
+        std::vector<std::vector<weighted_rhs> > by_head(symbols);
+        std::vector<int> heads;
+        for(int r = 0; r < rules; ++r) {
+            if (!keep[r])
+                continue;
+            int head = g.head(r);
+            weighted_rhs wr;
+            for(int i = 0; i < g.length(r); ++i)
+                wr.rhs.push_back(w.symbol_of(g.rhs(r)[i]));
+            wr.weight = weights[r];
+            if (!left_factor) {
+                w.add(w.symbol_of(head), wr.rhs, wr.weight);
+                continue;
+            }
+            if (by_head[head].empty())
+                heads.push_back(head);
+            by_head[head].push_back(wr);
+        }
+        for(int i = 0; i < heads.size(); ++i)
+            w.factor(w.symbol_of(heads[i]), g.name(heads[i]), by_head[heads[i]]);
+        return b.build();
+    }
+
+    void write_report(std::ostream& out, grammar const& g, grammar_report const& report) {
+        write_rules(out, g, "removed (non-productive): ", report.nonproductive);
+        write_rules(out, g, "removed (unreachable): ", report.unreachable);
+        write_rules(out, g, "removed (duplicate): ", report.duplicates);
+        for(int i = 0; i < report.factored.size(); ++i)
+            out << "added: " << report.factored[i] << "\n";
+    }
+
+}//namespace jhi
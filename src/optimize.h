@@ -0,0 +1,50 @@
+//      Copyright Joseph Irwin <joseph.irwin.gt@gmail.com>
+// Distributed under the Boost Software License, Version 1.0.
+//            http://www.boost.org/LICENSE_1_0.txt
+
+#ifndef __PARSER__OPTIMIZE_H__
+#define __PARSER__OPTIMIZE_H__
+
+#include "grammar.h"
+
+namespace jhi {
+
+    /**
+     * what optimize_grammar() removed or added; rule ids refer to the
+     * grammar it was given
+     */
+    struct grammar_report {
+        std::vector<int> nonproductive; //rules using a symbol that derives no string
+        std::vector<int> unreachable;   //rules for symbols the start symbol cannot reach
+        std::vector<int> duplicates;    //rules merged into an earlier identical rule
+        std::vector<std::string> factored; //non-terminals added by left-factoring
+    };
+
+    /**
+     * optimize_grammar
+     *
+     * returns a grammar for the same language with useless rules removed:
+     * rules using a non-productive symbol, then rules unreachable from the
+     * start symbol; duplicate rules are merged, adding their weights
+     *
+     * left_factor -- also replace rules with a common prefix by one rule
+     *     ending in a new non-terminal for the rest ("$np --> $det $np|$det"),
+     *     splitting weights so each derivation keeps its weight; parse trees
+     *     then contain the new non-terminals
+     *
+     * if `report` is given, it is filled in with what was changed
+     */
+    grammar optimize_grammar(
+            grammar const& g,
+            std::string const& start_symbol,
+            bool left_factor = false,
+            grammar_report* report = 0);
+
+    /**
+     * write a report as lines "removed (reason): rule" and "added: symbol"
+     */
+    void write_report(std::ostream& out, grammar const& g, grammar_report const& report);
+
+}//namespace jhi
+
+#endif //__PARSER__OPTIMIZE_H__
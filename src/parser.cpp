@@ -3,35 +3,367 @@
 //            http://www.boost.org/LICENSE_1_0.txt
 
 #include "chart.h"
+#include "forest.h"
+#include "optimize.h"
+#include "tokenizer.h"
+#include "tree_writer.h"
 
 #include <iostream>
+#include <fstream>
 #include <algorithm>
-#include "boost/lambda/lambda.hpp"
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include "boost/thread.hpp"
+
+namespace {
+
+    /**
+     * report on standard error a sentence that went over the context's limits
+     */
+    void report_limit(jhi::parser_context const& context, int sentence, int words) {
+        char const* limits[] = { "", "time", "item", "memory" };
+        std::cerr << "sentence " << sentence << ": " << limits[context.status()]
+                  << " limit reached at word " << context.sets_finished() << " of " << words << std::endl;
+    }
+
+    /**
+     * how each sentence is parsed and written
+     */
+    struct sentence_options {
+        int threads;     //completing the items of each Earley set
+        int max_parses;  //written for each sentence
+        bool fragments;  //write the fragment cover of sentences with no parse
+
+        sentence_options() : threads(1), max_parses(std::numeric_limits<int>::max()), fragments(false) {}
+    };
+
+    /**
+     * parse one sentence, writing the input and its parse trees
+     *
+     * a sentence going over the context's limits gets the parses found
+     * before it stopped, usually none
+     */
+    void parse_sentence(
+            jhi::tree_writer& out,
+            jhi::parser_context& context,
+            jhi::grammar const& g,
+            std::string const& start_symbol,
+            std::vector<jhi::token> const& input,
+            sentence_options const& options)
+    {
+        int threads = options.threads, max_parses = options.max_parses;
+        if (out.format() == jhi::forest_format) {
+            std::vector<char> image;
+            jhi::forest_image(g, start_symbol, jhi::recognize(context, g, start_symbol,
+                        input.empty() ? 0 : &input[0], input.size(), false, threads), image);
+            out.write_bytes(&image[0], image.size());
+            return;
+        }
+
+        //run Earley algorithm
+        jhi::constituent_vector parses;
+        if (max_parses == std::numeric_limits<int>::max()) {
+            parses = jhi::earley(context, g, start_symbol,
+                    input.empty() ? 0 : &input[0], input.size(), false, threads);
+        } else {
+            jhi::parse_enumerator e(g, start_symbol, jhi::recognize(context, g, start_symbol,
+                        input.empty() ? 0 : &input[0], input.size(), false, threads));
+            jhi::constituent_ptr tree;
+            while (parses.size() < max_parses && e.next(tree))
+                parses.push_back(tree);
+        }
+        if (parses.empty() && options.fragments && !input.empty()) {
+            //one tree holding the fragments
+            parses.push_back(jhi::constituent_ptr(new jhi::constituent(0, input.size(), "$fragments",
+                            jhi::fragment_cover(g, context.last_chart(), &input[0], input.size()))));
+        }
+        //dump parse trees
+        out.begin_sentence(input.empty() ? 0 : &input[0], input.size(), parses.size());
+        for(int i = 0; i < parses.size(); ++i)
+            out.write(*parses[i]);
+        out.end_sentence();
+    }
+
+    /**
+     * sentences of a corpus are parsed this many at a time, their output
+     * being kept until the whole batch is written in order
+     */
+    int const corpus_batch = 1024;
+
+    /**
+     * parses the sentences of a batch handed out one at a time by `next`,
+     * writing the output of each to its own buffer
+     */
+    struct corpus_worker {
+        jhi::corpus const* corpus;
+        jhi::grammar const* g;
+        std::string const* start_symbol;
+        jhi::parser_context* context;
+        jhi::tree_format format;
+        sentence_options options;
+        int first;  //batch
+        int last;
+        int* next;
+        boost::mutex* lock;
+        std::vector<std::string>* out;
+
+        void operator()() const {
+            std::vector<jhi::token> input;
+            std::ostringstream text;
+            jhi::tree_writer writer(text, format);
+            while (true) {
+                int i;
+                {
+                    boost::mutex::scoped_lock l(*lock);
+                    i = (*next)++;
+                }
+                if (i >= last)
+                    break;
+                corpus->sentence(i, input);
+                text.str("");
+                if (format == jhi::indented_format)
+                    text << "# sentence " << i << "\n";
+                parse_sentence(writer, *context, *g, *start_symbol, input, options);
+                writer.flush();
+                if (context->status() != jhi::parse_finished) {
+                    boost::mutex::scoped_lock l(*lock);
+                    report_limit(*context, i, input.size());
+                }
+                (*out)[i - first] = text.str();
+            }
+        }
+    };
+
+    /**
+     * parse sentences [first, last) of a corpus with `workers` threads,
+     * writing the output in corpus order; each thread's context is a copy
+     * of `settings`, with its limits and span bound
+     */
+    void parse_corpus(
+            jhi::corpus const& corpus,
+            jhi::grammar const& g,
+            std::string const& start_symbol,
+            jhi::tree_format format,
+            sentence_options const& options,
+            jhi::parser_context const& settings,
+            int first, int last,
+            int workers)
+    {
+        last = std::min(last, corpus.size());
+        workers = std::max(workers, 1);
+        sentence_options one_thread(options);
+        one_thread.threads = 1; //sentences are parsed in parallel instead
+        std::vector<jhi::parser_context> contexts(workers, settings);
+        std::vector<std::string> out(corpus_batch);
+        boost::mutex lock;
+        for(int batch = first; batch < last; batch += corpus_batch) {
+            int end = std::min(batch + corpus_batch, last);
+            int next = batch;
+            if (workers == 1) {
+                corpus_worker w = { &corpus, &g, &start_symbol, &contexts[0], format, one_thread,
+                    batch, end, &next, &lock, &out };
+                w();
+            } else {
+                boost::thread_group group;
+                for(int t = 0; t < workers; ++t) {
+                    corpus_worker w = { &corpus, &g, &start_symbol, &contexts[t], format, one_thread,
+                        batch, end, &next, &lock, &out };
+                    group.create_thread(w);
+                }
+                group.join_all();
+            }
+            for(int i = 0; i < end - batch; ++i)
+                std::cout << out[i];
+        }
+        std::cout.flush();
+    }
+
+}//namespace
 
 /**
  * parser - executable runs the Earley chart parsing algorithm on its input
  *
+ * usage: parser [-g grammar] [-s start symbol] [-O] [-f] [-t] [-j threads]
+ *               [-i corpus [-w workers] [-r first:last]] [-n parses] [-F]
+ *               [-L seconds:items:megabytes] [-S span[:glue symbols]] [-o format]
+ *               [-c output]
+ *
  * input: accepts a sentence as input, with one token on each line
  * output: outputs all parse trees found
+ *
+ * -g -- grammar file, in text form or a compiled grammar image
+ *       (default: the built-in grammar)
+ * -s -- start symbol (default: $sentence)
+ * -O -- remove useless and duplicate rules, reporting them on standard error
+ * -f -- as -O, and also left-factor rules sharing a prefix
+ * -t -- the input is plain text: split it into sentences and tokens, and
+ *       parse each sentence
+ * -j -- number of threads completing the items of each Earley set
+ * -i -- parse the sentences of a corpus file instead, one sentence per line
+ *       with tokens separated by white space (or plain text with -t); the
+ *       file is mapped and its sentences indexed, so they are read in place
+ * -w -- number of threads parsing sentences of the corpus
+ * -r -- parse only sentences first to last - 1 of the corpus (counting
+ *       from 0; either may be left out), to resume a run or split a corpus
+ * -L -- stop parsing a sentence after this long, once its chart holds this
+ *       many items, or once the chart takes this much memory (any may be
+ *       left out or 0, for no limit); such sentences are reported on
+ *       standard error
+ * -S -- keep constituents to at most this many words, except those of the
+ *       start symbol and of glue rules: the rules headed by the symbols
+ *       given after a colon, separated by commas
+ * -n -- write at most this many parses of each sentence; trees past the
+ *       last are never built
+ * -F -- for a sentence with no parse, write one tree headed $fragments
+ *       instead, covering the sentence with the fewest constituents found
+ *       (see fragment_cover)
+ * -o -- output format: indented (default), penn, json, binary (see
+ *       tree_writer.h) or forest (packed forests, see forest.h)
+ * -c -- compile the grammar to an image file and exit
  */
-int main()
+int main(int argc, char** argv)
 {
-    std::vector<std::string> input;
-    std::string line;
-    //read input; 1 token per line
-    while(std::getline(std::cin, line)) {
-        input.push_back(line);
-    }
-    std::cout << "Input: ";
-    std::for_each(input.begin(), input.end(), std::cout << boost::lambda::_1 << " ");
-    std::cout << std::endl;
-
-    //run Earley algorithm
-    jhi::constituent_vector parses
-        = jhi::earley(jhi::grammar(jhi::get_default_rules()), "$sentence", input);
-    std::cout << "# parses: " << parses.size() << std::endl;
-    //dump parse trees
-    for(int i = 0; i < parses.size(); ++i)
-        jhi::print_constituent(parses[i]);
+    char const* grammar_file = 0;
+    char const* compile_to = 0;
+    bool optimize = false, left_factor = false, tokenize = false;
+    int workers = 1;
+    sentence_options options;
+    jhi::parse_limits limits;
+    int max_span = 0;
+    std::string glue;
+    char const* corpus_file = 0;
+    int first = 0, last = std::numeric_limits<int>::max();
+    jhi::tree_format format = jhi::indented_format;
+    std::string start_symbol = "$sentence";
+    for(int i = 1; i < argc; ++i) {
+        if (!std::strcmp(argv[i], "-g") && i + 1 < argc) {
+            grammar_file = argv[++i];
+        } else if (!std::strcmp(argv[i], "-s") && i + 1 < argc) {
+            start_symbol = argv[++i];
+        } else if (!std::strcmp(argv[i], "-O")) {
+            optimize = true;
+        } else if (!std::strcmp(argv[i], "-f")) {
+            optimize = left_factor = true;
+        } else if (!std::strcmp(argv[i], "-t")) {
+            tokenize = true;
+        } else if (!std::strcmp(argv[i], "-j") && i + 1 < argc) {
+            options.threads = std::atoi(argv[++i]);
+        } else if (!std::strcmp(argv[i], "-i") && i + 1 < argc) {
+            corpus_file = argv[++i];
+        } else if (!std::strcmp(argv[i], "-w") && i + 1 < argc) {
+            workers = std::atoi(argv[++i]);
+        } else if (!std::strcmp(argv[i], "-r") && i + 1 < argc) {
+            char const* range = argv[++i];
+            char const* colon = std::strchr(range, ':');
+            if (range != colon)
+                first = std::atoi(range);
+            if (colon && colon[1])
+                last = std::atoi(colon + 1);
+        } else if (!std::strcmp(argv[i], "-n") && i + 1 < argc) {
+            options.max_parses = std::max(std::atoi(argv[++i]), 0);
+        } else if (!std::strcmp(argv[i], "-F")) {
+            options.fragments = true;
+        } else if (!std::strcmp(argv[i], "-L") && i + 1 < argc) {
+            char const* bound = argv[++i];
+            limits.seconds = std::atof(bound);
+            if ((bound = std::strchr(bound, ':'))) {
+                limits.items = std::atoi(++bound);
+                if ((bound = std::strchr(bound, ':')))
+                    limits.bytes = std::size_t(std::atof(bound + 1) * (1 << 20));
+            }
+        } else if (!std::strcmp(argv[i], "-S") && i + 1 < argc) {
+            char const* bound = argv[++i];
+            max_span = std::atoi(bound);
+            if ((bound = std::strchr(bound, ':')))
+                glue = bound + 1;
+        } else if (!std::strcmp(argv[i], "-o") && i + 1 < argc && jhi::find_tree_format(argv[i + 1], format)) {
+            ++i;
+        } else if (!std::strcmp(argv[i], "-c") && i + 1 < argc) {
+            compile_to = argv[++i];
+        } else {
+            std::cerr << "usage: " << argv[0]
+                      << " [-g grammar] [-s start symbol] [-O] [-f] [-t] [-j threads]"
+                      << " [-i corpus [-w workers] [-r first:last]] [-n parses] [-F]"
+                      << " [-L seconds:items:megabytes] [-S span[:glue symbols]] [-o format] [-c output]"
+                      << std::endl;
+            return 1;
+        }
+    }
+
+    jhi::grammar g(jhi::get_default_rules());
+    try {
+        if (grammar_file)
+            g = jhi::load_grammar(grammar_file);
+    } catch (std::exception const& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    if (optimize) {
+        jhi::grammar_report report;
+        jhi::grammar o = jhi::optimize_grammar(g, start_symbol, left_factor, &report);
+        jhi::write_report(std::cerr, g, report);
+        std::cerr << "# rules: " << g.size() << " -> " << o.size() << std::endl;
+        g = o;
+    }
+    if (compile_to) {
+        std::ofstream out(compile_to, std::ios::binary);
+        g.save(out);
+        return out ? 0 : 1;
+    }
+
+    jhi::parser_context context;
+    context.set_limits(limits);
+    if (max_span > 0) {
+        //rules headed by the glue symbols are free of the bound
+        std::vector<int> glue_rules;
+        std::istringstream symbols(glue);
+        for(std::string symbol; std::getline(symbols, symbol, ','); ) {
+            int s = g.find(symbol);
+            if (s < 0)
+                std::cerr << "no glue symbol " << symbol << " in the grammar" << std::endl;
+            for(int r = 0; r < g.size(); ++r)
+                if (g.head(r) == s)
+                    glue_rules.push_back(r);
+        }
+        context.set_max_span(max_span, glue_rules);
+    }
+
+    if (corpus_file) {
+        try {
+            jhi::corpus corpus(corpus_file, tokenize ? jhi::split_text : jhi::pretokenized);
+            parse_corpus(corpus, g, start_symbol, format, options, context, first, last, workers);
+        } catch (std::exception const& e) {
+            std::cerr << e.what() << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    //read input into one buffer; tokens are viewed in place
+    std::string text((std::istreambuf_iterator<char>(std::cin)), std::istreambuf_iterator<char>());
+    std::vector<jhi::token> input;
+    jhi::tree_writer out(std::cout, format);
+    if (tokenize) {
+        jhi::tokenizer t(text.data(), text.data() + text.size());
+        for(int sentence = 0; t.next(input); ++sentence) {
+            parse_sentence(out, context, g, start_symbol, input, options);
+            if (context.status() != jhi::parse_finished)
+                report_limit(context, sentence, input.size());
+        }
+        return 0;
+    }
+    //1 token per line
+    for(std::size_t begin = 0; begin < text.size(); ) {
+        std::size_t end = std::min(text.find('\n', begin), text.size());
+        input.push_back(jhi::token(text.data() + begin, end - begin));
+        begin = end + 1;
+    }
+    parse_sentence(out, context, g, start_symbol, input, options);
+    if (context.status() != jhi::parse_finished)
+        report_limit(context, 0, input.size());
     return 0;
 }
@@ -0,0 +1,160 @@
+//      Copyright Joseph Irwin <joseph.irwin.gt@gmail.com>
+// Distributed under the Boost Software License, Version 1.0.
+//            http://www.boost.org/LICENSE_1_0.txt
+
+#include "tokenizer.h"
+
+#include <fstream>
+#include <stdexcept>
+#include "boost/interprocess/file_mapping.hpp"
+#include "boost/interprocess/mapped_region.hpp"
+
+namespace {
+
+    enum char_class {
+        space_class = 1,
+        word_class = 2,     //letters, digits, non-ASCII bytes
+        joiner_class = 4,   //part of a word when followed by a word character
+        final_class = 8,    //may end a sentence
+        closing_class = 16, //may follow the end of a sentence
+        opening_class = 32, //may start a sentence
+        capital_class = 64  //may start a sentence
+    };
+
+    /**
+     * the classes of every byte, so each character of the text is classified
+     * with one lookup
+     */
+    struct class_table {
+        unsigned char classes[256];
+
+        class_table() {
+            for(int c = 0; c < 256; ++c) {
+                unsigned char k = 0;
+                if (c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v')
+                    k |= space_class;
+                if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c >= 0x80)
+                    k |= word_class;
+                if ((c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c >= 0x80)
+                    k |= capital_class;
+                if (c == '.' || c == '\'' || c == '-')
+                    k |= joiner_class;
+                if (c == '.' || c == '!' || c == '?')
+                    k |= final_class;
+                if (c == '"' || c == '\'' || c == ')' || c == ']' || c == '}')
+                    k |= closing_class;
+                if (c == '"' || c == '\'' || c == '(' || c == '[' || c == '{' || c == '`')
+                    k |= opening_class;
+                classes[c] = k;
+            }
+        }
+    };
+
+    class_table const table;
+
+    inline unsigned char classes(char c) {
+        return table.classes[static_cast<unsigned char>(c)];
+    }
+
+}//namespace
+
+namespace jhi {
+
+    text_file::text_file(std::string const& path) : _begin(""), _size(0) {
+        namespace bip = boost::interprocess;
+        std::ifstream in(path.c_str(), std::ios::binary | std::ios::ate);
+        if (!in)
+            throw std::runtime_error("cannot open text file: " + path);
+        if (in.tellg() == std::streampos(0))
+            return; //an empty file cannot be mapped
+        bip::file_mapping file(path.c_str(), bip::read_only);
+        boost::shared_ptr<bip::mapped_region> region(
+                new bip::mapped_region(file, bip::read_only));
+        _storage = region;
+        _begin = static_cast<char const*>(region->get_address());
+        _size = region->get_size();
+    }
+
+    bool tokenizer::next(std::vector<token>& out) {
+        out.clear();
+        int newlines = 0;
+        while (_p != _end) {
+            char c = *_p;
+            unsigned char k = classes(c);
+            if (k & space_class) {
+                ++_p;
+                if (c == '\n' && (_mode != split_text || ++newlines == 2) && !out.empty())
+                    return true;
+                continue;
+            }
+            newlines = 0;
+            char const* start = _p++;
+            if (_mode == pretokenized) {
+                while (_p != _end && !(classes(*_p) & space_class))
+                    ++_p;
+                out.push_back(token(start, _p - start));
+                continue;
+            }
+            if (k & word_class) {
+                while (_p != _end) {
+                    if (classes(*_p) & word_class)
+                        ++_p;
+                    else if ((classes(*_p) & joiner_class) && _p + 1 != _end
+                            && (classes(_p[1]) & word_class))
+                        _p += 2;
+                    else
+                        break;
+                }
+                out.push_back(token(start, _p - start));
+                continue;
+            }
+            //punctuation: a run of the same mark is one token
+            while (_p != _end && *_p == c)
+                ++_p;
+            out.push_back(token(start, _p - start));
+            if (_mode == split_text && (k & final_class) && sentence_ends(out))
+                return true;
+        }
+        return !out.empty();
+    }
+
+    /**
+     * after a mark that may end a sentence: add any closing quotes or
+     * brackets to the sentence, then look past the white space after them
+     * for the start of another sentence
+     */
+    bool tokenizer::sentence_ends(std::vector<token>& out) {
+        while (_p != _end && (classes(*_p) & closing_class)) {
+            char const* start = _p;
+            char c = *_p++;
+            while (_p != _end && *_p == c)
+                ++_p;
+            out.push_back(token(start, _p - start));
+        }
+        char const* q = _p;
+        if (q != _end && !(classes(*q) & space_class))
+            return false;
+        while (q != _end && (classes(*q) & space_class))
+            ++q;
+        return q == _end || (classes(*q) & (capital_class | opening_class));
+    }
+
+    corpus::corpus(std::string const& path, tokenizer_mode mode)
+        : _file(path), _mode(mode)
+    {
+        //a sentence runs from where the tokenizer stood before reading it
+        //to where it stopped, so tokenizing that range alone gives the
+        //same tokens
+        tokenizer t(_file.begin(), _file.end(), mode);
+        std::vector<token> tokens;
+        _offsets.push_back(0);
+        while (t.next(tokens))
+            _offsets.push_back(t.position() - _file.begin());
+    }
+
+    void corpus::sentence(int i, std::vector<token>& out) const {
+        tokenizer t(_file.begin() + _offsets[i], _file.begin() + _offsets[i + 1], _mode);
+        t.next(out);
+    }
+
+}//namespace jhi
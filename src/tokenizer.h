@@ -0,0 +1,102 @@
+//      Copyright Joseph Irwin <joseph.irwin.gt@gmail.com>
+// Distributed under the Boost Software License, Version 1.0.
+//            http://www.boost.org/LICENSE_1_0.txt
+
+#ifndef __PARSER__TOKENIZER_H__
+#define __PARSER__TOKENIZER_H__
+
+#include "grammar.h"
+
+namespace jhi {
+
+    /**
+     * class text_file
+     *
+     * a file mapped read-only into memory, so it can be tokenized in place;
+     * copies share the mapping
+     *
+     * throws std::runtime_error if the file cannot be opened
+     */
+    class text_file {
+            boost::shared_ptr<void const> _storage;
+            char const* _begin;
+            std::size_t _size;
+        public:
+            explicit text_file(std::string const& path);
+
+            char const* begin() const { return _begin; }
+            char const* end() const { return _begin + _size; }
+            std::size_t size() const { return _size; }
+    };
+
+    /**
+     * how a tokenizer finds sentences and tokens
+     */
+    enum tokenizer_mode {
+        split_text,     //sentences end at punctuation or blank lines
+        split_lines,    //each line is a sentence
+        pretokenized    //each line is a sentence of tokens separated by white space
+    };
+
+    /**
+     * class tokenizer
+     *
+     * splits text into sentences, and sentences into tokens, in one pass over
+     * the text; tokens are views of the text, so nothing is copied
+     *
+     * a token is a run of word characters (letters, digits and any non-ASCII
+     * byte), which may contain a period, apostrophe or hyphen followed by
+     * another word character ("3.14", "don't", "well-known"), or a run of one
+     * punctuation mark ("," or "..."). a sentence ends after '.', '!' or '?'
+     * (and any closing quotes or brackets after it) when the text ends or the
+     * next token starts with a capital letter, digit or opening mark; a blank
+     * line also ends a sentence
+     *
+     * in the other modes each line with a token is a sentence instead (see
+     * tokenizer_mode)
+     */
+    class tokenizer {
+            char const* _p;
+            char const* _end;
+            tokenizer_mode _mode;
+
+            bool sentence_ends(std::vector<token>& out);
+        public:
+            tokenizer(char const* begin, char const* end, tokenizer_mode mode = split_text)
+                : _p(begin), _end(end), _mode(mode) {}
+
+            /**
+             * read the tokens of the next sentence into `out`, replacing its
+             * contents; returns false, leaving `out` empty, at the end of the
+             * text
+             */
+            bool next(std::vector<token>& out);
+
+            /** the first character not yet read */
+            char const* position() const { return _p; }
+    };
+
+    /**
+     * class corpus
+     *
+     * a mapped text file and the offsets of its sentences, found with one
+     * tokenizer pass; sentences are then read in any order, by any number of
+     * threads, straight out of the mapping
+     */
+    class corpus {
+            text_file _file;
+            tokenizer_mode _mode;
+            std::vector<std::size_t> _offsets; //sentence i is [_offsets[i], _offsets[i + 1])
+        public:
+            corpus(std::string const& path, tokenizer_mode mode);
+
+            /** number of sentences */
+            int size() const { return _offsets.size() - 1; }
+
+            /** read the tokens of sentence `i` into `out`, replacing its contents */
+            void sentence(int i, std::vector<token>& out) const;
+    };
+
+}//namespace jhi
+
+#endif //__PARSER__TOKENIZER_H__
@@ -0,0 +1,271 @@
+//      Copyright Joseph Irwin <joseph.irwin.gt@gmail.com>
+// Distributed under the Boost Software License, Version 1.0.
+//            http://www.boost.org/LICENSE_1_0.txt
+
+#include "tree_writer.h"
+
+#include <cstring>
+
+namespace {
+
+    /**
+     * true for a node holding a word of the input
+     */
+    inline bool word_node(jhi::constituent const& node) {
+        return node.children().empty() && jhi::is_terminal(node.head());
+    }
+
+    char const spaces[] = "                                ";
+
+}//namespace
+
+namespace jhi {
+
+    tree_writer::tree_writer(std::ostream& out, tree_format format, std::size_t buffer_size)
+        : _out(out), _format(format), _buffer(buffer_size > 0 ? buffer_size : 1), _used(0), _trees(0) {}
+
+    tree_writer::~tree_writer() {
+        flush_buffer();
+    }
+
+    void tree_writer::flush_buffer() {
+        _out.write(&_buffer[0], _used);
+        _used = 0;
+    }
+
+    void tree_writer::flush() {
+        flush_buffer();
+        _out.flush();
+    }
+
+    void tree_writer::put(char const* text, std::size_t length) {
+        while (length > 0) {
+            if (_used == _buffer.size())
+                flush_buffer();
+            std::size_t n = std::min(length, _buffer.size() - _used);
+            std::memcpy(&_buffer[_used], text, n);
+            _used += n;
+            text += n;
+            length -= n;
+        }
+    }
+
+    void tree_writer::put_int(boost::int32_t n) {
+        boost::uint32_t u = n;
+        char bytes[4] = { char(u), char(u >> 8), char(u >> 16), char(u >> 24) };
+        put(bytes, 4);
+    }
+
+    void tree_writer::put_number(int n) {
+        char digits[12];
+        int i = sizeof(digits);
+        unsigned u = n < 0 ? 0u - unsigned(n) : unsigned(n);
+        do {
+            digits[--i] = '0' + u % 10;
+            u /= 10;
+        } while (u);
+        if (n < 0)
+            digits[--i] = '-';
+        put(digits + i, sizeof(digits) - i);
+    }
+
+    void tree_writer::put_json_string(char const* text, std::size_t length) {
+        static char const hex[] = "0123456789abcdef";
+        put('"');
+        for(std::size_t i = 0; i < length; ++i) {
+            unsigned char c = text[i];
+            if (c == '"' || c == '\\') {
+                put('\\');
+                put(char(c));
+            } else if (c < 0x20) {
+                char escape[6] = { '\\', 'u', '0', '0', hex[c >> 4], hex[c & 15] };
+                put(escape, 6);
+            } else {
+                put(char(c));
+            }
+        }
+        put('"');
+    }
+
+    void tree_writer::put_penn_string(char const* text, std::size_t length) {
+        for(std::size_t i = 0; i < length; ++i) {
+            switch (text[i]) {
+                case '(': put("-LRB-", 5); break;
+                case ')': put("-RRB-", 5); break;
+                case '{': put("-LCB-", 5); break;
+                case '}': put("-RCB-", 5); break;
+                default: put(text[i]);
+            }
+        }
+    }
+
+    /**
+     * a non-terminal's label, without its '$'
+     */
+    void tree_writer::put_label(std::string const& head) {
+        std::size_t skip = !head.empty() && head[0] == '$';
+        if (_format == json_format)
+            put_json_string(head.data() + skip, head.size() - skip);
+        else if (_format == penn_format)
+            put_penn_string(head.data() + skip, head.size() - skip);
+        else
+            put(head.data() + skip, head.size() - skip);
+    }
+
+    void tree_writer::begin_sentence(token const* input, int length, int parses) {
+        _trees = 0;
+        switch (_format) {
+            case indented_format:
+                put("Input: ", 7);
+                for(int i = 0; i < length; ++i) {
+                    put(input[i].text, input[i].length);
+                    put(' ');
+                }
+                put("\n# parses: ", 11);
+                put_number(parses);
+                put('\n');
+                break;
+            case penn_format:
+                break;
+            case json_format:
+                put("{\"input\":[", 10);
+                for(int i = 0; i < length; ++i) {
+                    if (i > 0)
+                        put(',');
+                    put_json_string(input[i].text, input[i].length);
+                }
+                put("],\"parses\":[", 12);
+                break;
+            case binary_format:
+                put_int(length);
+                for(int i = 0; i < length; ++i) {
+                    put_int(input[i].length);
+                    put(input[i].text, input[i].length);
+                }
+                put_int(parses);
+                break;
+            case forest_format:
+                break;
+        }
+    }
+
+    void tree_writer::end_sentence() {
+        if (_format == penn_format)
+            put('\n');
+        else if (_format == json_format)
+            put("]}\n", 3);
+    }
+
+    void tree_writer::write(constituent const& tree) {
+        if (_format == forest_format)
+            return;
+        _stack.clear();
+        open(tree, 0, _trees++ == 0);
+        frame top = { &tree, 0 };
+        _stack.push_back(top);
+        while (!_stack.empty()) {
+            frame& f = _stack.back();
+            if (f.next < f.node->children().size()) {
+                constituent const& child = *f.node->children()[f.next];
+                open(child, _stack.size(), f.next++ == 0);
+                frame down = { &child, 0 };
+                _stack.push_back(down);
+            } else {
+                close(*f.node, _stack.size() - 1);
+                _stack.pop_back();
+            }
+        }
+        if (_format == penn_format)
+            put('\n');
+    }
+
+    /**
+     * write what comes before the children of a node; `first` is true for
+     * the first child of its parent (or first tree of its sentence)
+     */
+    void tree_writer::open(constituent const& node, int depth, bool first) {
+        bool word = word_node(node);
+        switch (_format) {
+            case indented_format:
+                for(int n = depth * 4; n > 0; n -= sizeof(spaces) - 1)
+                    put(spaces, std::min<int>(n, sizeof(spaces) - 1));
+                if (word) {
+                    put('\'');
+                    put(node.head());
+                    put("'\n", 2);
+                } else {
+                    put('(');
+                    put(node.head());
+                    put('\n');
+                }
+                break;
+            case penn_format:
+                if (depth > 0)
+                    put(' ');
+                if (word) {
+                    put_penn_string(node.head().data(), node.head().size());
+                } else {
+                    put('(');
+                    put_label(node.head());
+                }
+                break;
+            case json_format:
+                if (!first)
+                    put(',');
+                put(word ? "{\"word\":" : "{\"label\":", word ? 8 : 9);
+                put_label(node.head());
+                put(",\"start\":", 9);
+                put_number(node.start());
+                put(",\"end\":", 7);
+                put_number(node.end());
+                put(word ? "}" : ",\"children\":[", word ? 1 : 13);
+                break;
+            case binary_format:
+                put_int(node.start());
+                put_int(node.end());
+                put_int(node.children().size());
+                put_int(node.head().size());
+                put(node.head());
+                break;
+            case forest_format:
+                break;
+        }
+    }
+
+    /**
+     * write what comes after the children of a node
+     */
+    void tree_writer::close(constituent const& node, int depth) {
+        if (word_node(node))
+            return;
+        switch (_format) {
+            case indented_format:
+                for(int n = depth * 4; n > 0; n -= sizeof(spaces) - 1)
+                    put(spaces, std::min<int>(n, sizeof(spaces) - 1));
+                put(")\n", 2);
+                break;
+            case penn_format:
+                put(')');
+                break;
+            case json_format:
+                put("]}", 2);
+                break;
+            case binary_format:
+            case forest_format:
+                break;
+        }
+    }
+
+    bool find_tree_format(std::string const& name, tree_format& format) {
+        char const* names[] = { "indented", "penn", "json", "binary", "forest" };
+        tree_format formats[] = { indented_format, penn_format, json_format, binary_format, forest_format };
+        for(int i = 0; i < 5; ++i) {
+            if (name == names[i]) {
+                format = formats[i];
+                return true;
+            }
+        }
+        return false;
+    }
+
+}//namespace jhi
@@ -0,0 +1,111 @@
+//      Copyright Joseph Irwin <joseph.irwin.gt@gmail.com>
+// Distributed under the Boost Software License, Version 1.0.
+//            http://www.boost.org/LICENSE_1_0.txt
+
+#ifndef __PARSER__TREE_WRITER_H__
+#define __PARSER__TREE_WRITER_H__
+
+#include "chart.h"
+
+namespace jhi {
+
+    /**
+     * output formats for parse trees
+     *
+     * indented_format -- the parser's listing: the input, the number of
+     *     parses, then each tree with one node per line
+     * penn_format -- one bracketed tree per line, "(sentence (np ...) ...)",
+     *     labels without their '$'; a blank line ends each sentence.
+     *     brackets in words and labels are written as in the Penn
+     *     Treebank: -LRB- -RRB- for '(' ')' and -LCB- -RCB- for '{' '}'
+     * json_format -- one object per sentence and line:
+     *     {"input":[words],"parses":[trees]}, a node being
+     *     {"label":"np","start":0,"end":2,"children":[nodes]} or
+     *     {"word":"the","start":0,"end":1}
+     * binary_format -- per sentence: the number of words, each word, the
+     *     number of parses, then the nodes of each tree in preorder, a node
+     *     being its start, end, number of children and label. numbers are
+     *     32-bit little-endian, strings a 32-bit length and their bytes
+     * forest_format -- no trees: the packed forest of each sentence is
+     *     written instead, as a forest image (see forest.h)
+     */
+    enum tree_format {
+        indented_format,
+        penn_format,
+        json_format,
+        binary_format,
+        forest_format
+    };
+
+    /**
+     * class tree_writer
+     *
+     * writes the parse trees of sentences in one of the tree formats
+     *
+     * output is collected in a buffer and written to the stream when the
+     * buffer fills, on flush(), and on destruction; trees are walked with an
+     * explicit stack, so deep trees cannot overflow the call stack, and
+     * writing a tree allocates nothing once the writer has seen a tree as
+     * deep
+     */
+    class tree_writer {
+            struct frame {
+                constituent const* node;
+                int next; //next child to write
+            };
+
+            std::ostream& _out;
+            tree_format _format;
+            std::vector<char> _buffer;
+            std::size_t _used;
+            std::vector<frame> _stack;
+            int _trees; //written for the current sentence
+
+            void put(char const* text, std::size_t length);
+            void put(char c) {
+                if (_used == _buffer.size())
+                    flush_buffer();
+                _buffer[_used++] = c;
+            }
+            void put(std::string const& text) { put(text.data(), text.size()); }
+            void put_int(boost::int32_t n);
+            void put_number(int n);
+            void put_json_string(char const* text, std::size_t length);
+            void put_penn_string(char const* text, std::size_t length);
+            void put_label(std::string const& head);
+            void flush_buffer();
+
+            void open(constituent const& node, int depth, bool first);
+            void close(constituent const& node, int depth);
+
+        public:
+            tree_writer(std::ostream& out, tree_format format, std::size_t buffer_size = 1 << 16);
+            ~tree_writer();
+
+            /** start a sentence, before its trees */
+            void begin_sentence(token const* input, int length, int parses);
+
+            /** write one tree of the sentence */
+            void write(constituent const& tree);
+
+            /** finish a sentence, after its trees */
+            void end_sentence();
+
+            /** write bytes as they are, such as a forest image */
+            void write_bytes(char const* data, std::size_t size) { put(data, size); }
+
+            /** write out the buffer and flush the stream */
+            void flush();
+
+            tree_format format() const { return _format; }
+    };
+
+    /**
+     * find a tree format by name ("indented", "penn", "json", "binary" or
+     * "forest"); returns false if there is none
+     */
+    bool find_tree_format(std::string const& name, tree_format& format);
+
+}//namespace jhi
+
+#endif //__PARSER__TREE_WRITER_H__
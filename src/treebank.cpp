@@ -0,0 +1,267 @@
+//      Copyright Joseph Irwin <joseph.irwin.gt@gmail.com>
+// Distributed under the Boost Software License, Version 1.0.
+//            http://www.boost.org/LICENSE_1_0.txt
+
+#include "treebank.h"
+
+#include <fstream>
+#include <iomanip>
+#include <algorithm>
+#include <stdexcept>
+#include "boost/thread.hpp"
+
+namespace {
+
+    inline bool is_space(char ch) {
+        return ch == ' ' || ch == '\t' || ch == '\n' || ch == '\r';
+    }
+
+    /**
+     * replace each '$' in a label or leaf with -DOL-
+     */
+    void escape_dollars(std::string& token) {
+        for(std::size_t i = token.find('$'); i != std::string::npos; i = token.find('$', i + 5))
+            token.replace(i, 1, "-DOL-");
+    }
+
+    /**
+     * a piece of a treebank file, starting at the beginning of a tree and
+     * ending between trees
+     */
+    struct shard {
+        std::string file;
+        std::streamoff begin;
+        std::streamoff end;
+    };
+
+    /**
+     * find the first tree that starts at or after `pos`, counting brackets
+     * from `from`, which must be between trees; a line starting with '('
+     * may be inside a tree whose lines are not indented, so only a '(' at
+     * depth 0 starts one. returns `size` if there is none
+     */
+    std::streamoff next_tree(std::ifstream& in, std::streamoff from, std::streamoff pos, std::streamoff size) {
+        in.clear();
+        in.seekg(from);
+        std::vector<char> buffer(1 << 16);
+        int depth = 0;
+        while (in) {
+            in.read(&buffer[0], buffer.size());
+            for(std::streamsize i = 0; i < in.gcount(); ++i, ++from) {
+                char ch = buffer[i];
+                if (ch == '(') {
+                    if (depth == 0 && from >= pos)
+                        return from;
+                    ++depth;
+                } else if (ch == ')' && depth > 0) {
+                    --depth;
+                }
+            }
+        }
+        return size;
+    }
+
+    /**
+     * cut the files into about `pieces` shards in total
+     */
+    std::vector<shard> make_shards(std::vector<std::string> const& files, int pieces) {
+        std::vector<std::streamoff> sizes;
+        std::streamoff total = 0;
+        for(int f = 0; f < files.size(); ++f) {
+            std::ifstream in(files[f].c_str(), std::ios::binary | std::ios::ate);
+            if (!in)
+                throw std::runtime_error("cannot open treebank file: " + files[f]);
+            sizes.push_back(in.tellg());
+            total += sizes.back();
+        }
+
+        std::streamoff target = std::max<std::streamoff>(1, total / pieces);
+        std::vector<shard> shards;
+        for(int f = 0; f < files.size(); ++f) {
+            std::ifstream in(files[f].c_str(), std::ios::binary);
+            std::streamoff begin = 0;
+            while (begin < sizes[f]) {
+                std::streamoff end = sizes[f] - begin > target
+                    ? next_tree(in, begin, begin + target, sizes[f])
+                    : sizes[f];
+                shard s = { files[f], begin, end };
+                shards.push_back(s);
+                begin = end;
+            }
+        }
+        return shards;
+    }
+
+    /**
+     * counts rules for shards taken in turn from a shared list
+     */
+    struct count_worker {
+        std::vector<shard> const* shards;
+        int* next;
+        boost::mutex* lock;
+        jhi::rule_count_map* counts;
+        long* trees;
+        std::string* error;
+
+        void operator()() const {
+            std::vector<char> buffer(1 << 20);
+            jhi::rule_extractor extractor(*counts);
+            while (true) {
+                int s;
+                {
+                    boost::mutex::scoped_lock l(*lock);
+                    s = (*next)++;
+                }
+                if (s >= shards->size())
+                    break;
+
+                shard const& sh = (*shards)[s];
+                std::ifstream in(sh.file.c_str(), std::ios::binary);
+                in.seekg(sh.begin);
+                std::streamoff left = sh.end - sh.begin;
+                while (left > 0 && in) {
+                    in.read(&buffer[0], std::min<std::streamoff>(left, buffer.size()));
+                    extractor.feed(&buffer[0], &buffer[0] + in.gcount());
+                    left -= in.gcount();
+                }
+                //a shard ends between trees, unless the file ends inside one
+                if (!extractor.at_boundary()) {
+                    boost::mutex::scoped_lock l(*lock);
+                    *error = "treebank file ends inside a tree: " + sh.file;
+                    *next = shards->size();
+                    break;
+                }
+            }
+            *trees = extractor.trees();
+        }
+    };
+}
+
+namespace jhi {
+
+    void rule_extractor::feed(char const* p, char const* end) {
+        while (p != end) {
+            char ch = *p;
+            if (ch == '(') {
+                token();
+                open();
+                ++p;
+            } else if (ch == ')') {
+                token();
+                close();
+                ++p;
+            } else if (is_space(ch)) {
+                token();
+                ++p;
+            } else {
+                char const* q = p;
+                while (q != end && *q != '(' && *q != ')' && !is_space(*q))
+                    ++q;
+                _token.append(p, q);
+                p = q;
+            }
+        }
+    }
+
+    void rule_extractor::token() {
+        if (_token.empty())
+            return;
+        escape_dollars(_token);
+        if (_depth > 0) {
+            frame& f = _stack[_depth - 1];
+            if (_label) {
+                f.rule.append("$").append(_token).append(" -->");
+                _label = false;
+            } else if (!f.rule.empty()) {
+                f.rule.append(" ").append(_token);
+                ++f.children;
+            }
+        }
+        _token.clear();
+    }
+
+    void rule_extractor::open() {
+        //if the parent is still waiting for its label, it is left unlabeled
+        _label = true;
+        if (_depth == _stack.size())
+            _stack.push_back(frame());
+        frame& f = _stack[_depth++];
+        f.rule.clear();
+        f.children = 0;
+    }
+
+    void rule_extractor::close() {
+        _label = false;
+        if (_depth == 0)
+            return;
+        frame& f = _stack[--_depth];
+        if (!f.rule.empty() && f.children > 0)
+            ++_counts[f.rule];
+        if (_depth > 0) {
+            frame& parent = _stack[_depth - 1];
+            if (!parent.rule.empty() && !f.rule.empty()) {
+                parent.rule.append(" ").append(f.rule, 0, f.rule.find(" -->"));
+                ++parent.children;
+            }
+        } else {
+            ++_trees;
+        }
+    }
+
+    long count_rules(
+            std::vector<std::string> const& files,
+            int threads,
+            rule_count_map& counts)
+    {
+        if (threads < 1) threads = 1;
+        std::vector<shard> shards(make_shards(files, threads * 4));
+
+        int next = 0;
+        boost::mutex lock;
+        std::vector<rule_count_map> local(threads);
+        std::vector<long> trees(threads, 0);
+        std::string error;
+        boost::thread_group group;
+        for(int t = 0; t < threads; ++t) {
+            count_worker w = { &shards, &next, &lock, &local[t], &trees[t], &error };
+            if (threads == 1)
+                w();
+            else
+                group.create_thread(w);
+        }
+        group.join_all();
+        if (!error.empty())
+            throw std::runtime_error(error);
+
+        long total = 0;
+        for(int t = 0; t < threads; ++t) {
+            total += trees[t];
+            for(rule_count_map::const_iterator it = local[t].begin(); it != local[t].end(); ++it)
+                counts[it->first] += it->second;
+        }
+        return total;
+    }
+
+    void write_grammar(std::ostream& out, rule_count_map const& counts, bool raw_counts) {
+        typedef rule_count_map::const_iterator iter;
+        std::vector<std::string> rules;
+        rules.reserve(counts.size());
+        rule_count_map head_totals;
+        for(iter it = counts.begin(); it != counts.end(); ++it) {
+            rules.push_back(it->first);
+            head_totals[it->first.substr(0, it->first.find(" -->"))] += it->second;
+        }
+        std::sort(rules.begin(), rules.end());
+
+        std::streamsize precision = out.precision(12);
+        for(int i = 0; i < rules.size(); ++i) {
+            long n = counts.find(rules[i])->second;
+            if (raw_counts)
+                out << n;
+            else
+                out << double(n) / head_totals[rules[i].substr(0, rules[i].find(" -->"))];
+            out << "\t" << rules[i] << "\n";
+        }
+        out.precision(precision);
+    }
+}
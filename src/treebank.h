@@ -0,0 +1,93 @@
+//      Copyright Joseph Irwin <joseph.irwin.gt@gmail.com>
+// Distributed under the Boost Software License, Version 1.0.
+//            http://www.boost.org/LICENSE_1_0.txt
+
+#ifndef __PARSER__TREEBANK_H__
+#define __PARSER__TREEBANK_H__
+
+#include <string>
+#include <vector>
+#include <iostream>
+
+#include "boost/unordered_map.hpp"
+
+namespace jhi {
+
+    /**
+     * maps the text of a rule ("$np --> $det $noun") to the number of times it was seen
+     */
+    typedef boost::unordered_map<std::string, long> rule_count_map;
+
+    /**
+     * class rule_extractor
+     *
+     * reads Penn-style bracketed trees and counts the rules used in them
+     *
+     * input is fed in blocks of any size, so trees (and tokens) may be split
+     * across calls to feed(); node labels get a '$' prefix to mark them as
+     * non-terminals, leaves are kept as terminals. an unlabeled root node, as
+     * in "( (S ...) )", is skipped.
+     *
+     * a '$' in a label or leaf is written -DOL-, like the Penn Treebank's
+     * -LRB- for '(', so the word "$" stays a terminal and the tag "PRP$"
+     * does not end in the non-terminal prefix
+     */
+    class rule_extractor {
+            struct frame {
+                std::string rule;  //"$label -->" followed by the children seen so far
+                int children;
+            };
+
+            std::vector<frame> _stack;
+            int _depth;
+            std::string _token;
+            bool _label;           //true if the next token is a node label
+            long _trees;
+            rule_count_map& _counts;
+
+            void token();
+            void open();
+            void close();
+        public:
+            rule_extractor(rule_count_map& counts)
+                : _depth(0), _label(false), _trees(0), _counts(counts) {}
+
+            /** count the rules in the next block of input */
+            void feed(char const* begin, char const* end);
+
+            /** number of complete trees read */
+            long trees() const { return _trees; }
+
+            /** true if the input read so far ends between trees */
+            bool at_boundary() const { return _depth == 0 && _token.empty(); }
+    };
+
+    /**
+     * count the rules in the given treebank files
+     *
+     * files are cut into shards between trees (where the brackets balance)
+     * and the shards are divided between `threads` workers, each with its
+     * own counts
+     *
+     * returns the number of trees read; throws std::runtime_error naming
+     * the first file that cannot be opened, or a file that ends inside a
+     * tree (the counts are then incomplete)
+     */
+    long count_rules(
+            std::vector<std::string> const& files,
+            int threads,
+            rule_count_map& counts);
+
+    /**
+     * write a weighted grammar, one rule per line, sorted by rule:
+     *
+     *     <weight> <head> --> <rhs symbol> ...
+     *
+     * the weight is the relative frequency of the rule among rules with the
+     * same head, or the raw count if `raw_counts` is set
+     */
+    void write_grammar(std::ostream& out, rule_count_map const& counts, bool raw_counts=false);
+
+}//namespace jhi
+
+#endif //__PARSER__TREEBANK_H__
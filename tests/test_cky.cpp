@@ -0,0 +1,127 @@
+#include <UnitTest++.h>
+#include "cky.h"
+#include "chart.h"
+
+#include <cstdlib>
+#include <sstream>
+#include <stdexcept>
+
+SUITE(CkyTests)
+{
+    TEST(AgreesWithEarleyOnBinarizedDefaultGrammar)
+    {
+        std::vector<jhi::rule> rules(jhi::get_default_rules());
+        for(int i = 0; i < rules.size(); ++i)
+            if (rules[i] == jhi::rule("$np", "$det", "$adj", "$noun"))
+                rules[i] = jhi::rule("$np", "$det", "$nbar");
+        rules.push_back(jhi::rule("$nbar", "$adj", "$noun"));
+        rules.push_back(jhi::rule("$np", "$np", "$pp"));
+        jhi::grammar g(rules);
+        jhi::cky_grammar cg(g);
+        char const* words[] = { "the", "boy", "hits", "a", "smart", "dog", "with", "rod" };
+        std::vector<std::string> input;
+        input.push_back("the"); input.push_back("boy"); input.push_back("hits");
+        input.push_back("a"); input.push_back("long"); input.push_back("rod");
+        CHECK(jhi::accepted(g, cg, "$sentence", jhi::cky_recognize(g, cg, input)));
+
+        //random strings over the lexicon
+        std::srand(1);
+        for(int t = 0; t < 200; ++t) {
+            std::vector<std::string> s(1 + std::rand() % 9);
+            for(int i = 0; i < s.size(); ++i)
+                s[i] = words[std::rand() % 8];
+            bool earley = !jhi::earley(g, "$sentence", s).empty();
+            CHECK_EQUAL(earley, jhi::accepted(g, cg, "$sentence", jhi::cky_recognize(g, cg, s)));
+        }
+    }
+
+    TEST(HandlesUnaryChainsAndManyLabels)
+    {
+        //more than 64 labels, so masks span several words
+        std::vector<jhi::rule> rules;
+        std::vector<std::string> labels;
+        for(int i = 0; i < 150; ++i) {
+            std::ostringstream l;
+            l << "$l" << i;
+            labels.push_back(l.str());
+        }
+        for(int i = 0; i + 1 < 150; ++i)
+            rules.push_back(jhi::rule(labels[i + 1], labels[i]));
+        rules.push_back(jhi::rule(labels[0], "x"));
+        rules.push_back(jhi::rule("$s", labels[149], labels[70]));
+        jhi::grammar g(rules);
+        jhi::cky_grammar cg(g);
+        CHECK_EQUAL(151, cg.labels());
+
+        std::vector<std::string> input(2, "x");
+        jhi::cky_chart c = jhi::cky_recognize(g, cg, input);
+        CHECK(jhi::accepted(g, cg, "$s", c));
+        CHECK(c.contains(0, 1, cg.label(g.find(labels[100]))));
+        CHECK(!jhi::accepted(g, cg, "$s", jhi::cky_recognize(g, cg, std::vector<std::string>(3, "x"))));
+    }
+
+    TEST(AgreesWithEarleyOnDenseRandomGrammar)
+    {
+        //many right children per left child, spread over two mask words,
+        //so the heads come from tables of several right children at once
+        std::srand(3);
+        std::vector<std::string> labels;
+        for(int i = 0; i < 80; ++i) {
+            std::ostringstream l;
+            l << "$l" << i;
+            labels.push_back(l.str());
+        }
+        std::vector<jhi::rule> rules;
+        for(int i = 0; i < 1500; ++i)
+            rules.push_back(jhi::rule(labels[std::rand() % 80],
+                        labels[std::rand() % 80], labels[std::rand() % 80]));
+        char const* words[] = { "p", "q", "r" };
+        for(int i = 0; i < 30; ++i)
+            rules.push_back(jhi::rule(labels[std::rand() % 80], words[i % 3]));
+        jhi::grammar g(rules);
+        jhi::cky_grammar cg(g);
+
+        for(int t = 0; t < 20; ++t) {
+            std::vector<std::string> s(1 + std::rand() % 5);
+            for(int i = 0; i < s.size(); ++i)
+                s[i] = words[std::rand() % 3];
+            for(int l = 0; l < 80; l += 7) {
+                bool earley = !jhi::earley(g, labels[l], s).empty();
+                CHECK_EQUAL(earley, jhi::accepted(g, cg, labels[l], jhi::cky_recognize(g, cg, s)));
+            }
+        }
+    }
+
+    TEST(ThreadedChartMatchesSingleThread)
+    {
+        std::vector<jhi::rule> rules;
+        rules.push_back(jhi::rule("$s", "$s", "$s"));
+        rules.push_back(jhi::rule("$s", "$a", "$b"));
+        rules.push_back(jhi::rule("$s", "$b", "$a"));
+        rules.push_back(jhi::rule("$a", "x"));
+        rules.push_back(jhi::rule("$b", "y"));
+        rules.push_back(jhi::rule("$b", "$s"));
+        jhi::grammar g(rules);
+        jhi::cky_grammar cg(g);
+
+        std::srand(2);
+        std::vector<std::string> input(61);
+        for(int i = 0; i < input.size(); ++i)
+            input[i] = std::rand() % 2 ? "x" : "y";
+        jhi::cky_chart one = jhi::cky_recognize(g, cg, input);
+        jhi::cky_chart four = jhi::cky_recognize(g, cg, input, 4);
+        int n = input.size();
+        for(int i = 0; i < n; ++i)
+            for(int j = i + 1; j <= n; ++j)
+                for(int l = 0; l < cg.labels(); ++l)
+                    CHECK_EQUAL(one.contains(i, j, l), four.contains(i, j, l));
+    }
+
+    TEST(RejectsGrammarsThatAreNotBinarized)
+    {
+        std::vector<jhi::rule> rules;
+        rules.push_back(jhi::rule("$np", "$det", "$adj", "$noun"));
+        jhi::grammar g(rules);
+        CHECK_THROW(jhi::cky_grammar cg(g), std::runtime_error);
+    }
+}
@@ -1,6 +1,148 @@
 #include <UnitTest++.h>
 #include "chart.h"
 
+#include <sstream>
+#include <cstdlib>
+#include <new>
+#include <set>
+
+namespace {
+    //heap allocations made by the test program
+    long allocations = 0;
+
+    bool same_chart(jhi::chart const& a, jhi::chart const& b) {
+        if (a.size() != b.size())
+            return false;
+        for(int i = 0; i < a.size(); ++i) {
+            if (a[i].size() != b[i].size())
+                return false;
+            for(int j = 0; j < a[i].size(); ++j) {
+                if (!(a[i][j] == b[i][j])
+                    || a.back_pointers(i, j).size() != b.back_pointers(i, j).size())
+                    return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * a grammar whose sets each start with rounds of 300 items, enough to
+     * be completed in parallel, while each item has few back pointers
+     */
+    std::vector<jhi::rule> wide_grammar() {
+        std::vector<jhi::rule> rules;
+        for(int k = 0; k < 300; ++k) {
+            std::ostringstream a;
+            a << "$a" << k;
+            rules.push_back(jhi::rule(a.str(), "x"));
+            rules.push_back(jhi::rule("$w", a.str()));
+        }
+        rules.push_back(jhi::rule("$s", "$w", "$s"));
+        rules.push_back(jhi::rule("$s", "$w"));
+        return rules;
+    }
+
+    /**
+     * sentences over x and y, some with right recursion and empty
+     * constituents, longest first
+     */
+    std::vector<std::vector<std::string> > reuse_sentences() {
+        char const* text[] = { "x y x x y x x x", "x", "x x y", "", "y", "x y x y x y" };
+        std::vector<std::vector<std::string> > ret;
+        for(int i = 0; i < 6; ++i) {
+            std::istringstream in(text[i]);
+            std::vector<std::string> words;
+            for(std::string w; in >> w; )
+                words.push_back(w);
+            ret.push_back(words);
+        }
+        return ret;
+    }
+
+    std::string print(jhi::constituent_vector const& trees) {
+        std::ostringstream out;
+        for(int i = 0; i < trees.size(); ++i)
+            jhi::print_constituent(out, trees[i]);
+        return out.str();
+    }
+
+    /**
+     * check that enumerating the trees one at a time gives those of
+     * parse_trees(), in order
+     */
+    void check_enumeration(jhi::grammar const& g, std::string const& start, std::vector<std::string> const& input) {
+        jhi::chart c(jhi::recognize(g, start, input));
+        jhi::constituent_vector trees;
+        jhi::parse_enumerator e(g, start, c);
+        for(jhi::constituent_ptr t; e.next(t); )
+            trees.push_back(t);
+        jhi::constituent_ptr t;
+        CHECK(!e.next(t));
+        CHECK_EQUAL(print(jhi::parse_trees(g, start, c)), print(trees));
+    }
+
+    /**
+     * true if the constituents of a tree headed by other than the given
+     * symbols span at most `max_span` words
+     */
+    bool within_span(jhi::constituent_ptr const& t, int max_span, std::set<std::string> const& free) {
+        if (!free.count(t->head()) && t->end() - t->start() > max_span)
+            return false;
+        for(int i = 0; i < t->children().size(); ++i)
+            if (!within_span(t->children()[i], max_span, free))
+                return false;
+        return true;
+    }
+
+    /**
+     * check that bounding spans gives exactly the unbounded parses within
+     * the bound, returning their number
+     */
+    int check_span_bound(jhi::grammar const& g, std::string const& start, std::vector<std::string> const& input,
+            int max_span, std::vector<int> const& glue, std::set<std::string> const& free)
+    {
+        jhi::constituent_vector all = jhi::earley(g, start, input);
+        int expected = 0;
+        for(int i = 0; i < all.size(); ++i)
+            expected += within_span(all[i], max_span, free);
+
+        jhi::parser_context context;
+        context.set_max_span(max_span, glue);
+        jhi::constituent_vector bounded = jhi::parse_trees(g, start, jhi::recognize(context, g, start, input));
+        for(int i = 0; i < bounded.size(); ++i)
+            CHECK(within_span(bounded[i], max_span, free));
+        CHECK_EQUAL(expected, bounded.size());
+        return bounded.size();
+    }
+
+    jhi::grammar reuse_grammar() {
+        std::vector<jhi::rule> rules;
+        rules.push_back(jhi::rule("$s", "$a", "$s"));
+        rules.push_back(jhi::rule("$s", "$a"));
+        rules.push_back(jhi::rule("$a", "x", "$o"));
+        rules.push_back(jhi::rule("$o"));
+        rules.push_back(jhi::rule("$o", "y"));
+        return jhi::grammar(rules);
+    }
+}
+
+void* operator new(std::size_t size) {
+    ++allocations;
+    if (void* p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) throw() {
+    std::free(p);
+}
+
+#ifdef __cpp_sized_deallocation
+void operator delete(void* p, std::size_t) throw() {
+    std::free(p);
+}
+#endif
+
 SUITE(ChartParseAlgoTests)
 {
     TEST(CanParseSimpleSentenceWithTestGrammar)
@@ -78,7 +220,7 @@ SUITE(ChartParseAlgoTests)
 
         jhi::constituent_vector parses =
             jhi::earley(g, "$np", input);
-        CHECK_EQUAL(2, parses.size());
+        CHECK_EQUAL(4, parses.size());
     }
 
     TEST(CanParseSimpleSentenceWithDefaultGrammar)
@@ -97,4 +239,567 @@ SUITE(ChartParseAlgoTests)
         CHECK_EQUAL(1, parses.size());
         //CHECK(false);
     }
+
+    TEST(CanParseOptionalConstituents)
+    {
+        std::vector<jhi::rule> rules;
+        rules.push_back(jhi::rule("$np", "$det", "$adj", "$noun"));
+        rules.push_back(jhi::rule("$adj"));
+        rules.push_back(jhi::rule("$adj", "big"));
+        rules.push_back(jhi::rule("$det", "the"));
+        rules.push_back(jhi::rule("$noun", "dog"));
+        jhi::grammar g(rules);
+
+        std::vector<std::string> input;
+        input.push_back("the");
+        input.push_back("dog");
+        CHECK_EQUAL(1, jhi::earley(g, "$np", input).size());
+
+        input.insert(input.begin() + 1, "big");
+        CHECK_EQUAL(1, jhi::earley(g, "$np", input).size());
+    }
+
+    TEST(CompletesNullableSymbolsPredictedAfterTheyComplete)
+    {
+        //S -> A A x, A -> E, E -> (empty): the classic case Earley's
+        //algorithm misses without special handling of nullable symbols
+        std::vector<jhi::rule> rules;
+        rules.push_back(jhi::rule("$s", "$a", "$a", "x"));
+        rules.push_back(jhi::rule("$a", "$e"));
+        rules.push_back(jhi::rule("$e"));
+        jhi::grammar g(rules);
+        CHECK(g.nullable(g.find("$a")));
+        CHECK(!g.nullable(g.find("$s")));
+
+        std::vector<std::string> input;
+        input.push_back("x");
+        jhi::constituent_vector parses = jhi::earley(g, "$s", input);
+        CHECK_EQUAL(1, parses.size());
+        CHECK_EQUAL(3, parses[0]->children().size());
+        CHECK_EQUAL(1, parses[0]->children()[0]->children().size());
+    }
+
+    TEST(CanParseEmptyInput)
+    {
+        std::vector<jhi::rule> rules;
+        rules.push_back(jhi::rule("$s", "$a", "$b"));
+        rules.push_back(jhi::rule("$a"));
+        rules.push_back(jhi::rule("$b"));
+        rules.push_back(jhi::rule("$b", "$a"));
+        jhi::grammar g(rules);
+
+        CHECK_EQUAL(2, jhi::earley(g, "$s", std::vector<std::string>()).size());
+    }
+
+    TEST(RightRecursionCreatesLinearNumberOfItems)
+    {
+        std::vector<jhi::rule> rules;
+        rules.push_back(jhi::rule("$list", "$item", "$list"));
+        rules.push_back(jhi::rule("$list", "$item"));
+        rules.push_back(jhi::rule("$item", "x"));
+        jhi::grammar g(rules);
+
+        std::vector<std::string> input(200, "x");
+        jhi::chart c(jhi::recognize(g, "$list", input));
+        int items = 0;
+        for(int i = 0; i < c.size(); ++i)
+            items += c[i].size();
+        //without reduction paths each set would hold an item per earlier position
+        CHECK(items < 20 * c.size());
+
+        jhi::constituent_vector parses = jhi::parse_trees(g, "$list", c);
+        CHECK_EQUAL(1, parses.size());
+        jhi::constituent_ptr t = parses[0];
+        int depth = 0;
+        while (t->children().size() == 2) {
+            CHECK_EQUAL(depth, t->start());
+            CHECK_EQUAL(200, t->end());
+            t = t->children()[1];
+            ++depth;
+        }
+        CHECK_EQUAL(199, depth);
+    }
+
+    TEST(RightRecursionKeepsAmbiguity)
+    {
+        std::vector<jhi::rule> rules;
+        rules.push_back(jhi::rule("$s", "$a", "$s"));
+        rules.push_back(jhi::rule("$s", "$a"));
+        rules.push_back(jhi::rule("$a", "x"));
+        rules.push_back(jhi::rule("$a", "x", "x"));
+        jhi::grammar g(rules);
+
+        //compositions of 5 into parts of 1 and 2
+        std::vector<std::string> input(5, "x");
+        CHECK_EQUAL(8, jhi::earley(g, "$s", input).size());
+    }
+
+    TEST(ParsesShareIdenticalSubtrees)
+    {
+        std::vector<jhi::rule> rules;
+        rules.push_back(jhi::rule("$s", "$a", "$s"));
+        rules.push_back(jhi::rule("$s", "$a"));
+        rules.push_back(jhi::rule("$a", "x"));
+        rules.push_back(jhi::rule("$a", "x", "x"));
+        jhi::grammar g(rules);
+
+        std::vector<std::string> input(5, "x");
+        jhi::constituent_table table;
+        jhi::constituent_vector parses = jhi::parse_trees(g, "$s", jhi::recognize(g, "$s", input), table);
+        CHECK_EQUAL(8, parses.size());
+
+        //every parse ending in "$a --> x" over the last word uses one node for it
+        std::set<jhi::constituent const*> last;
+        std::vector<jhi::constituent_ptr> stack(parses.begin(), parses.end());
+        int nodes = 0;
+        while (!stack.empty()) {
+            jhi::constituent_ptr c = stack.back();
+            stack.pop_back();
+            ++nodes;
+            if (c->head() == "$a" && c->start() == 4)
+                last.insert(c.get());
+            stack.insert(stack.end(), c->children().begin(), c->children().end());
+        }
+        CHECK_EQUAL(1, last.size());
+        CHECK(table.size() < nodes / 2);
+
+        //equal trees are the same object
+        jhi::constituent_vector word(1, table.make(0, 1, "x"));
+        CHECK(table.make(0, 1, "$a", word) == table.make(0, 1, std::string("$a"), word));
+        CHECK(table.make(0, 1, "$a", word) != table.make(0, 1, "$b", word));
+    }
+
+    TEST(UnaryCyclesGiveFiniteParses)
+    {
+        std::vector<jhi::rule> rules;
+        rules.push_back(jhi::rule("$a", "$b"));
+        rules.push_back(jhi::rule("$b", "$a"));
+        rules.push_back(jhi::rule("$a", "x"));
+        rules.push_back(jhi::rule("$b", "y"));
+        jhi::grammar g(rules);
+
+        //a(b(a(x))) nests an $a in an $a over the same words
+        CHECK_EQUAL(1, jhi::earley(g, "$a", std::vector<std::string>(1, "x")).size());
+        CHECK_EQUAL(1, jhi::earley(g, "$a", std::vector<std::string>(1, "y")).size());
+    }
+
+    TEST(CyclesThroughEmptyConstituentsGiveFiniteParses)
+    {
+        std::vector<jhi::rule> rules;
+        rules.push_back(jhi::rule("$s", "$s", "$e"));
+        rules.push_back(jhi::rule("$s", "$e", "$s"));
+        rules.push_back(jhi::rule("$s", "x"));
+        rules.push_back(jhi::rule("$e"));
+        jhi::grammar g(rules);
+
+        CHECK_EQUAL(1, jhi::earley(g, "$s", std::vector<std::string>(1, "x")).size());
+        CHECK_EQUAL(0, jhi::earley(g, "$s", std::vector<std::string>()).size());
+    }
+
+    TEST(EnumeratesTheTreesOfParseTreesInOrder)
+    {
+        std::vector<std::vector<std::string> > sentences(reuse_sentences());
+        for(int i = 0; i < sentences.size(); ++i)
+            check_enumeration(reuse_grammar(), "$s", sentences[i]);
+
+        std::vector<jhi::rule> rules;
+        rules.push_back(jhi::rule("$s", "$s", "$e"));
+        rules.push_back(jhi::rule("$s", "$e", "$s"));
+        rules.push_back(jhi::rule("$s", "$a"));
+        rules.push_back(jhi::rule("$a", "$s"));
+        rules.push_back(jhi::rule("$a", "x"));
+        rules.push_back(jhi::rule("$a", "x", "$a"));
+        rules.push_back(jhi::rule("$e"));
+        rules.push_back(jhi::rule("$e", "y"));
+        jhi::grammar g(rules);
+        char const* text[] = { "x", "x x", "x y x", "y x y", "x x x y" };
+        for(int i = 0; i < 5; ++i) {
+            std::istringstream in(text[i]);
+            std::vector<std::string> words;
+            for(std::string w; in >> w; )
+                words.push_back(w);
+            check_enumeration(g, "$s", words);
+        }
+    }
+
+    TEST(FirstParseSkipsTheOtherTrees)
+    {
+        //a Catalan number of trees: about 10 million for 16 words
+        std::vector<jhi::rule> rules;
+        rules.push_back(jhi::rule("$s", "$s", "$s"));
+        rules.push_back(jhi::rule("$s", "x"));
+        jhi::grammar g(rules);
+        std::vector<std::string> input(16, "x");
+        jhi::chart c(jhi::recognize(g, "$s", input));
+
+        jhi::constituent_ptr t = jhi::first_parse(g, "$s", c);
+        CHECK(t);
+        CHECK_EQUAL(0, t->start());
+        CHECK_EQUAL(16, t->end());
+
+        jhi::constituent_table table;
+        jhi::parse_enumerator e(g, "$s", c, table);
+        std::set<jhi::constituent const*> trees;
+        for(int k = 0; k < 100 && e.next(t); ++k)
+            trees.insert(t.get());
+        CHECK_EQUAL(100, trees.size());
+
+        CHECK(!jhi::first_parse(g, "$s", jhi::recognize(g, "$s", std::vector<std::string>())));
+    }
+
+    TEST(LimitsStopRecognitionEarly)
+    {
+        std::vector<jhi::rule> rules;
+        rules.push_back(jhi::rule("$s", "$s", "$s"));
+        rules.push_back(jhi::rule("$s", "x"));
+        jhi::grammar g(rules);
+        std::vector<std::string> input(200, "x");
+        jhi::parser_context context;
+
+        jhi::parse_limits limits;
+        limits.items = 1000;
+        context.set_limits(limits);
+        jhi::chart const& c = jhi::recognize(context, g, "$s", input);
+        CHECK_EQUAL(jhi::items_exceeded, context.status());
+        CHECK(c.item_count() < 2000);
+        CHECK(context.sets_finished() > 0);
+        CHECK(context.sets_finished() < c.size());
+        CHECK(c[context.sets_finished()].size() > 0);
+        CHECK(c[context.sets_finished() + 1].empty());
+        CHECK(jhi::goal_items(g, "$s", c).empty());
+
+        limits.items = 0;
+        limits.bytes = 100000;
+        context.set_limits(limits);
+        jhi::recognize(context, g, "$s", input);
+        CHECK_EQUAL(jhi::memory_exceeded, context.status());
+        CHECK(c.bytes() < 200000);
+
+        limits.bytes = 0;
+        limits.seconds = 1e-6;
+        context.set_limits(limits);
+        jhi::recognize(context, g, "$s", input);
+        CHECK_EQUAL(jhi::time_exceeded, context.status());
+
+        //limits are per sentence: a short one still fits
+        limits.seconds = 0;
+        limits.items = 1000;
+        context.set_limits(limits);
+        jhi::recognize(context, g, "$s", std::vector<std::string>(5, "x"));
+        CHECK_EQUAL(jhi::parse_finished, context.status());
+        CHECK_EQUAL(6, context.sets_finished());
+        CHECK_EQUAL(1, jhi::goal_items(g, "$s", c).size());
+    }
+
+    TEST(FragmentCoverUsesTheFewestConstituents)
+    {
+        std::vector<jhi::rule> rules;
+        rules.push_back(jhi::rule("$s", "$np", "$vp"));
+        rules.push_back(jhi::rule("$np", "the", "dog"));
+        rules.push_back(jhi::rule("$np", "the", "cat"));
+        rules.push_back(jhi::rule("$vp", "sees", "$np"));
+        jhi::grammar g(rules);
+
+        std::istringstream in("the dog sees the cat xyzzy the dog");
+        std::vector<std::string> words;
+        for(std::string w; in >> w; )
+            words.push_back(w);
+        std::vector<jhi::token> input;
+        for(int i = 0; i < words.size(); ++i)
+            input.push_back(jhi::token(words[i]));
+        jhi::chart c(jhi::recognize(g, "$s", words));
+        CHECK(jhi::goal_items(g, "$s", c).empty());
+
+        //items past "xyzzy" are not predicted, so its words are bare
+        jhi::constituent_vector f = jhi::fragment_cover(g, c, &input[0], input.size());
+        CHECK_EQUAL(4, f.size());
+        CHECK_EQUAL("$s", f[0]->head());
+        CHECK_EQUAL(5, f[0]->end());
+        CHECK_EQUAL(2, f[0]->children()[1]->start());
+        CHECK_EQUAL("xyzzy", f[1]->head());
+        CHECK(f[1]->children().empty());
+        CHECK_EQUAL("the", f[2]->head());
+        CHECK_EQUAL(7, f[3]->start());
+
+        //an unfinished sentence
+        words.resize(2);
+        c = jhi::recognize(g, "$s", words);
+        f = jhi::fragment_cover(g, c, &input[0], 2);
+        CHECK_EQUAL(1, f.size());
+        CHECK_EQUAL("$np", f[0]->head());
+    }
+
+    TEST(FragmentCoverHasOneBareWordPerUnknownWord)
+    {
+        std::vector<jhi::rule> rules;
+        rules.push_back(jhi::rule("$s", "$np", "$vp"));
+        rules.push_back(jhi::rule("$np", "the", "dog"));
+        rules.push_back(jhi::rule("$vp", "barks"));
+        jhi::grammar g(rules);
+
+        std::istringstream in("the dog barks xyzzy plugh");
+        std::vector<std::string> words;
+        for(std::string w; in >> w; )
+            words.push_back(w);
+        std::vector<jhi::token> input;
+        for(int i = 0; i < words.size(); ++i)
+            input.push_back(jhi::token(words[i]));
+        jhi::chart c(jhi::recognize(g, "$s", words));
+
+        jhi::constituent_vector f = jhi::fragment_cover(g, c, &input[0], input.size());
+        CHECK_EQUAL(3, f.size());
+        CHECK_EQUAL("$s", f[0]->head());
+        CHECK_EQUAL(3, f[0]->end());
+        CHECK_EQUAL("xyzzy", f[1]->head());
+        CHECK_EQUAL(3, f[1]->start());
+        CHECK_EQUAL(4, f[1]->end());
+        CHECK_EQUAL("plugh", f[2]->head());
+        CHECK_EQUAL(4, f[2]->start());
+        CHECK_EQUAL(5, f[2]->end());
+        for(int i = 1; i < f.size(); ++i)
+            CHECK(f[i]->children().empty());
+    }
+
+    TEST(FragmentsDerivedThroughReductionPathsAreUnfolded)
+    {
+        std::vector<jhi::rule> rules;
+        rules.push_back(jhi::rule("$list", "x", "$list"));
+        rules.push_back(jhi::rule("$list", "x"));
+        jhi::grammar g(rules);
+        std::vector<std::string> words(4, "x");
+        words.push_back("y");
+        std::vector<jhi::token> input;
+        for(int i = 0; i < words.size(); ++i)
+            input.push_back(jhi::token(words[i]));
+        jhi::chart c(jhi::recognize(g, "$list", words));
+
+        jhi::constituent_vector f = jhi::fragment_cover(g, c, &input[0], input.size());
+        CHECK_EQUAL(2, f.size());
+        int depth = 0;
+        for(jhi::constituent_ptr t = f[0]; t->children().size() > 0; t = t->children().back())
+            ++depth;
+        CHECK_EQUAL(4, depth);
+        CHECK_EQUAL("y", f[1]->head());
+    }
+
+    TEST(FragmentsCoverSentencesStoppedByLimits)
+    {
+        std::vector<jhi::rule> rules;
+        rules.push_back(jhi::rule("$s", "$s", "$s"));
+        rules.push_back(jhi::rule("$s", "x"));
+        jhi::grammar g(rules);
+        std::vector<jhi::token> input(200, jhi::token("x", 1));
+        jhi::parser_context context;
+        jhi::parse_limits limits;
+        limits.items = 1000;
+        context.set_limits(limits);
+        jhi::recognize(context, g, "$s", &input[0], input.size());
+        CHECK_EQUAL(jhi::items_exceeded, context.status());
+
+        jhi::constituent_vector f = jhi::fragment_cover(g, context.last_chart(), &input[0], input.size());
+        CHECK_EQUAL(0, f[0]->start());
+        CHECK(f[0]->end() >= context.sets_finished() - 1);
+        for(int i = 1; i < f.size(); ++i)
+            CHECK_EQUAL(f[i - 1]->end(), f[i]->start());
+        CHECK_EQUAL(200, f.back()->end());
+    }
+
+    TEST(SpanBoundKeepsTheParsesWithinIt)
+    {
+        //sequences of noun phrases of 1 to 3 words: tribonacci numbers
+        std::vector<std::string> input(10, "x");
+        std::set<std::string> free;
+        free.insert("$s");
+        std::vector<jhi::rule> rules;
+        rules.push_back(jhi::rule("$s", "$s", "$np"));
+        rules.push_back(jhi::rule("$s", "$np"));
+        rules.push_back(jhi::rule("$np", "$np", "x"));
+        rules.push_back(jhi::rule("$np", "x"));
+        CHECK_EQUAL(274, check_span_bound(jhi::grammar(rules), "$s", input, 3, std::vector<int>(), free));
+
+        //right recursion, completed through reduction paths
+        rules.clear();
+        rules.push_back(jhi::rule("$s", "$np", "$s"));
+        rules.push_back(jhi::rule("$s", "$np"));
+        rules.push_back(jhi::rule("$np", "x", "$np"));
+        rules.push_back(jhi::rule("$np", "x"));
+        rules.push_back(jhi::rule("$np", "x", "$e", "x"));
+        rules.push_back(jhi::rule("$e"));
+        jhi::grammar right(rules);
+        for(int span = 1; span <= 4; ++span)
+            check_span_bound(right, "$s", input, span, std::vector<int>(), free);
+
+        //glue rules under the start symbol
+        rules.clear();
+        rules.push_back(jhi::rule("$top", "$glue"));
+        rules.push_back(jhi::rule("$glue", "$glue", "$np"));
+        rules.push_back(jhi::rule("$glue", "$np"));
+        rules.push_back(jhi::rule("$np", "$np", "x"));
+        rules.push_back(jhi::rule("$np", "x"));
+        jhi::grammar glued(rules);
+        free.insert("$top");
+        CHECK_EQUAL(0, check_span_bound(glued, "$top", input, 3, std::vector<int>(), free));
+        std::vector<int> glue;
+        glue.push_back(1);
+        glue.push_back(2);
+        free.insert("$glue");
+        CHECK_EQUAL(274, check_span_bound(glued, "$top", input, 3, glue, free));
+    }
+
+    TEST(SpanBoundMakesItemsGrowLinearly)
+    {
+        std::vector<jhi::rule> rules;
+        rules.push_back(jhi::rule("$s", "$s", "$a"));
+        rules.push_back(jhi::rule("$s", "$a"));
+        rules.push_back(jhi::rule("$a", "$a", "$a"));
+        rules.push_back(jhi::rule("$a", "x"));
+        jhi::grammar g(rules);
+        jhi::parser_context context;
+        context.set_max_span(5);
+        int items[2];
+        for(int k = 0; k < 2; ++k) {
+            jhi::chart const& c = jhi::recognize(context, g, "$s", std::vector<std::string>(100 << k, "x"));
+            CHECK_EQUAL(1, jhi::goal_items(g, "$s", c).size());
+            items[k] = c.item_count();
+        }
+        CHECK(items[1] < 2.2 * items[0]);
+    }
+
+    TEST(PredictsOnlyRulesThatCanStartWithTheNextWord)
+    {
+        std::vector<jhi::rule> rules;
+        char const* words[] = { "a", "b", "c", "d", "e", "f", "g", "h" };
+        for(int i = 0; i < 8; ++i)
+            rules.push_back(jhi::rule("$s", words[i], "$s"));
+        rules.push_back(jhi::rule("$s"));
+        jhi::grammar g(rules);
+
+        std::vector<std::string> input(words, words + 8);
+        jhi::chart c(jhi::recognize(g, "$s", input));
+        //the rule for the next word and the empty rule
+        CHECK_EQUAL(2, c[0].size());
+        CHECK_EQUAL(1, jhi::parse_trees(g, "$s", c).size());
+    }
+
+    TEST(BackPointersKeepTheirOrderAsTheyMove)
+    {
+        std::vector<jhi::rule> rules;
+        rules.push_back(jhi::rule("$s", "$a", "$b"));
+        jhi::grammar g(rules);
+        jhi::chart c(g, 2);
+        //interleaved additions move each item's back pointers along its arena
+        for(int b = 0; b < 20; ++b)
+            for(int dot = 0; dot < 3; ++dot)
+                c.add(1, jhi::item(0, dot, 0), jhi::back_pointer(0, b, dot));
+        CHECK_EQUAL(3, c[1].size());
+        CHECK_EQUAL(60, c.back_pointer_count());
+        for(int i = 0; i < 3; ++i) {
+            CHECK_EQUAL(20, c.back_pointers(1, i).size());
+            for(int b = 0; b < c.back_pointers(1, i).size(); ++b) {
+                CHECK_EQUAL(b, c.back_pointers(1, i)[b].pred);
+                CHECK_EQUAL(c[1][i].dot, c.back_pointers(1, i)[b].child);
+            }
+        }
+        //reset keeps the arenas, and refilling starts them over
+        c.reset(g, 2);
+        c.add(1, jhi::item(0, 1, 0), jhi::back_pointer(0, 7, -1));
+        CHECK_EQUAL(1, c.back_pointers(1, 0).size());
+        CHECK_EQUAL(7, c.back_pointers(1, 0)[0].pred);
+    }
+
+    TEST(ThreadedRecognitionBuildsTheSameChart)
+    {
+        jhi::grammar g(wide_grammar());
+        std::vector<std::string> input(6, "x");
+        jhi::chart one = jhi::recognize(g, "$s", input);
+        jhi::chart four = jhi::recognize(g, "$s", input, false, 4);
+        CHECK_EQUAL(one.size(), four.size());
+        for(int i = 0; i < one.size(); ++i) {
+            CHECK_EQUAL(one[i].size(), four[i].size());
+            for(int j = 0; j < one[i].size() && j < four[i].size(); ++j) {
+                CHECK(one[i][j] == four[i][j]);
+                CHECK_EQUAL(one.back_pointers(i, j).size(), four.back_pointers(i, j).size());
+            }
+        }
+        CHECK(!jhi::goal_items(g, "$s", four).empty());
+    }
+
+    TEST(ContextKeepsItsThreadsBetweenSentences)
+    {
+        jhi::grammar g(wide_grammar());
+        jhi::parser_context context;
+        for(int n = 1; n <= 3; ++n) {
+            std::vector<std::string> input(n, "x");
+            CHECK(same_chart(jhi::recognize(g, "$s", input),
+                        jhi::recognize(context, g, "$s", input, false, 4)));
+            //a copy does not share the threads of the original
+            jhi::parser_context copy(context);
+            CHECK(same_chart(jhi::recognize(g, "$s", input),
+                        jhi::recognize(copy, g, "$s", input, false, 2)));
+        }
+    }
+
+    TEST(ReusedContextBuildsTheSameCharts)
+    {
+        jhi::grammar g(reuse_grammar());
+        std::vector<std::vector<std::string> > sentences(reuse_sentences());
+        jhi::parser_context context;
+        for(int pass = 0; pass < 2; ++pass) {
+            for(int i = 0; i < sentences.size(); ++i) {
+                jhi::chart const& reused = jhi::recognize(context, g, "$s", sentences[i]);
+                CHECK(same_chart(jhi::recognize(g, "$s", sentences[i]), reused));
+                CHECK(&reused == &context.last_chart());
+            }
+        }
+        CHECK_EQUAL(1, jhi::parse_trees(g, "$s",
+                    jhi::recognize(context, g, "$s", sentences[2])).size());
+    }
+
+    TEST(WarmContextRecognizesWithoutAllocating)
+    {
+        jhi::grammar g(reuse_grammar());
+        std::vector<std::vector<std::string> > sentences(reuse_sentences());
+        jhi::parser_context context;
+        long cold = allocations;
+        for(int i = 0; i < sentences.size(); ++i)
+            jhi::recognize(context, g, "$s", sentences[i]);
+        CHECK(allocations > cold);
+
+        long before = allocations;
+        int accepted = 0;
+        for(int pass = 0; pass < 3; ++pass) {
+            for(int i = 0; i < sentences.size(); ++i) {
+                jhi::chart const& c = jhi::recognize(context, g, "$s", sentences[i]);
+                for(int k = 0; k < c[c.size() - 1].size(); ++k)
+                    accepted += c[c.size() - 1].origin(k) == 0 && c[c.size() - 1].next(k) < 0;
+            }
+        }
+        CHECK_EQUAL(0, allocations - before);
+        CHECK(accepted > 0);
+    }
+
+    TEST(RecognizesTokensViewedInOneBuffer)
+    {
+        jhi::grammar g(jhi::get_default_rules());
+        char const text[] = "the boy hits the dog";
+        std::vector<jhi::token> input;
+        input.push_back(jhi::token(text, 3));
+        input.push_back(jhi::token(text + 4, 3));
+        input.push_back(jhi::token(text + 8, 4));
+        input.push_back(jhi::token(text + 13, 3));
+        input.push_back(jhi::token(text + 17, 3));
+
+        jhi::parser_context context;
+        jhi::constituent_vector parses = jhi::earley(context, g, "$sentence", &input[0], input.size());
+        CHECK_EQUAL(1, parses.size());
+        CHECK_EQUAL("dog", parses[0]->children()[1]->children()[1]->children()[1]->children()[0]->head());
+
+        std::vector<int> ids;
+        for(int i = 0; i < input.size(); ++i)
+            ids.push_back(g.find(input[i]));
+        ids[1] = -1;
+        CHECK(jhi::goal_items(g, "$sentence", jhi::recognize(context, g, "$sentence", &ids[0], ids.size())).empty());
+        ids[1] = g.find("rod");
+        CHECK_EQUAL(1, jhi::goal_items(g, "$sentence", jhi::recognize(context, g, "$sentence", &ids[0], ids.size())).size());
+    }
 }
@@ -0,0 +1,190 @@
+#include <UnitTest++.h>
+#include "forest.h"
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+    /**
+     * number of derivations of a node (or of a word, for a negative index)
+     */
+    double derivations(jhi::forest const& f, int node) {
+        if (node < 0 || f[node].length == 0)
+            return 1;
+        double n = 0;
+        for(int a = f.alternatives_begin(node); a != f.alternatives_end(node); ++a)
+            n += (f.alternative(a).pred < 0 ? 1 : derivations(f, f.alternative(a).pred))
+                * derivations(f, f.alternative(a).child);
+        return n;
+    }
+
+    double trees(jhi::forest const& f) {
+        double n = 0;
+        for(int k = 0; k < f.root_count(); ++k)
+            n += derivations(f, f.root(k));
+        return n;
+    }
+
+    void put_uint32(std::string& s, boost::uint32_t n) {
+        for(int i = 0; i < 4; ++i)
+            s += char(n >> 8 * i);
+    }
+
+    void put_uint64(std::string& s, boost::uint64_t n) {
+        put_uint32(s, boost::uint32_t(n));
+        put_uint32(s, boost::uint32_t(n >> 32));
+    }
+
+    void set_int32(std::string& s, std::size_t pos, boost::int32_t n) {
+        for(int i = 0; i < 4; ++i)
+            s[pos + i] = char(boost::uint32_t(n) >> 8 * i);
+    }
+
+    jhi::grammar ambiguous_grammar() {
+        std::vector<jhi::rule> rules;
+        rules.push_back(jhi::rule("$s", "$a", "$s"));
+        rules.push_back(jhi::rule("$s", "$a"));
+        rules.push_back(jhi::rule("$a", "x"));
+        rules.push_back(jhi::rule("$a", "x", "x"));
+        rules.push_back(jhi::rule("$a", "$b", "x"));
+        rules.push_back(jhi::rule("$b"));
+        return jhi::grammar(rules);
+    }
+}
+
+SUITE(ForestTests)
+{
+    TEST(ForestHoldsEveryParse)
+    {
+        jhi::grammar g(ambiguous_grammar());
+        std::vector<std::string> input(6, "x");
+        jhi::chart c(jhi::recognize(g, "$s", input));
+        std::vector<char> image;
+        jhi::forest_image(g, "$s", c, image);
+        CHECK_EQUAL(0, image.size() % 8);
+
+        jhi::forest f(&image[0], image.size());
+        CHECK_EQUAL(image.size(), f.image_size());
+        CHECK_EQUAL(6, f.words());
+        CHECK_EQUAL(1, f.root_count());
+        CHECK_EQUAL(std::string("x"), f.name(f.word(0)));
+        jhi::forest_node root = f[f.root(0)];
+        CHECK_EQUAL(std::string("$s"), f.name(root.symbol));
+        CHECK_EQUAL(0, root.start);
+        CHECK_EQUAL(6, root.end);
+        CHECK_EQUAL(root.length, root.dot);
+
+        CHECK_EQUAL(jhi::parse_trees(g, "$s", c).size(), trees(f));
+        //packed: fewer nodes than trees, though each tree has several
+        CHECK(f.size() < trees(f) / 2);
+    }
+
+    TEST(ForestsCanBeConcatenatedAndMapped)
+    {
+        jhi::grammar g(ambiguous_grammar());
+        std::string path = "test_forest.bin";
+        {
+            std::ofstream out(path.c_str(), std::ios::binary);
+            for(int n = 1; n <= 3; ++n)
+                jhi::write_forest(out, g, "$s", jhi::recognize(g, "$s", std::vector<std::string>(n, "x")));
+            jhi::write_forest(out, g, "$s", jhi::recognize(g, "$s", std::vector<std::string>(1, "y")));
+        }
+
+        jhi::forest f(jhi::forest::map(path));
+        for(int n = 1; n <= 3; ++n) {
+            std::vector<std::string> input(n, "x");
+            CHECK_EQUAL(n, f.words());
+            CHECK_EQUAL(jhi::parse_trees(g, "$s", jhi::recognize(g, "$s", input)).size(),
+                    trees(f));
+            CHECK(f.more());
+            f = f.next();
+        }
+        //no parse: an empty forest
+        CHECK_EQUAL(1, f.words());
+        CHECK_EQUAL(0, f.root_count());
+        CHECK_EQUAL(0, f.size());
+        CHECK_EQUAL(-1, f.word(0));
+        CHECK(!f.more());
+        std::remove(path.c_str());
+    }
+
+    TEST(ImageIsLittleEndian)
+    {
+        std::vector<jhi::rule> rules;
+        rules.push_back(jhi::rule("$s", "x"));
+        jhi::grammar g(rules);
+        std::vector<char> image;
+        jhi::forest_image(g, "$s", jhi::recognize(g, "$s", std::vector<std::string>(1, "x")), image);
+
+        std::string expected("JHIFRST", 8);
+        put_uint32(expected, 2);   //version
+        put_uint32(expected, 0);
+        put_uint64(expected, 232); //image size
+        put_uint32(expected, 1);   //words
+        put_uint32(expected, 2);   //symbols
+        put_uint32(expected, 1);   //nodes
+        put_uint32(expected, 1);   //roots
+        boost::uint64_t sections[][2] = {
+            { 152, 12 }, { 168, 5 }, { 176, 4 }, { 184, 24 }, { 208, 8 }, { 216, 8 }, { 224, 4 } };
+        for(int k = 0; k < 7; ++k) {
+            put_uint64(expected, sections[k][0]);
+            put_uint64(expected, sections[k][1]);
+        }
+        put_uint32(expected, 0);   //symbol offsets
+        put_uint32(expected, 3);
+        put_uint32(expected, 5);
+        put_uint32(expected, 0);
+        expected += std::string("$s\0x\0\0\0\0", 8);
+        put_uint32(expected, 1);   //word symbols
+        put_uint32(expected, 0);
+        boost::int32_t node[] = { 0, 0, 1, 1, 0, 1 };
+        for(int k = 0; k < 6; ++k)
+            put_uint32(expected, node[k]);
+        put_uint32(expected, 0);   //alternative offsets
+        put_uint32(expected, 1);
+        put_uint32(expected, -1);  //alternative: no predecessor, word 0
+        put_uint32(expected, -1);
+        put_uint32(expected, 0);   //roots
+        put_uint32(expected, 0);
+        CHECK_EQUAL(expected.size(), image.size());
+        CHECK(expected == std::string(image.begin(), image.end()));
+
+        jhi::forest f(expected.data(), expected.size());
+        CHECK_EQUAL(std::string("x"), f.name(f.word(0)));
+        CHECK_EQUAL(1, f[f.root(0)].end);
+        CHECK_EQUAL(-1, f.alternative(f.alternatives_begin(f.root(0))).child);
+    }
+
+    TEST(RejectsOtherData)
+    {
+        std::string junk(200, 'x');
+        CHECK_THROW(jhi::forest(junk.data(), junk.size()), std::runtime_error);
+    }
+
+    TEST(DamagedImagesAreRejected)
+    {
+        jhi::grammar g(ambiguous_grammar());
+        std::vector<char> saved;
+        jhi::forest_image(g, "$s", jhi::recognize(g, "$s", std::vector<std::string>(3, "x")), saved);
+        std::string image(saved.begin(), saved.end());
+        jhi::forest f(image.data(), image.size());
+        //the offset and size of each section follow the header's counts
+        boost::int32_t text = jhi::forest_int(&image[40 + 16 * 1]);
+        boost::int32_t text_size = jhi::forest_int(&image[40 + 16 * 1 + 8]);
+        boost::int32_t alternative_offsets = jhi::forest_int(&image[40 + 16 * 4]);
+        boost::int32_t alternatives = jhi::forest_int(&image[40 + 16 * 5]);
+        boost::int32_t roots = jhi::forest_int(&image[40 + 16 * 6]);
+
+        std::vector<std::string> damaged(6, image);
+        damaged[0][text + text_size - 1] = 'x';                     //an unterminated name
+        set_int32(damaged[1], alternatives + 4, f.size() + 3);      //a child past the nodes
+        set_int32(damaged[2], alternatives + 4, -2 - f.words());    //a word past the input
+        set_int32(damaged[3], alternatives, 1 << 30);               //a predecessor past the nodes
+        set_int32(damaged[4], alternative_offsets + 4 * f.size(), 1 << 30); //past the alternatives
+        set_int32(damaged[5], roots, -2);                           //a root before the nodes
+        for(int i = 0; i < damaged.size(); ++i)
+            CHECK_THROW(jhi::forest(damaged[i].data(), damaged[i].size()), std::runtime_error);
+    }
+}
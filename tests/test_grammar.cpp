@@ -1,7 +1,13 @@
 #include<UnitTest++.h>
 #include "grammar.h"
+#include "chart.h"
 
 #include <boost/shared_ptr.hpp>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
 
 SUITE(GrammarTests)
 {
@@ -29,4 +35,118 @@ SUITE(GrammarTests)
         //std::for_each(r.begin(), r.end(), std::cout << _1 << "\n");
         CHECK_EQUAL(1, g->rules_with_head("$sentence").size());
     }
+
+    TEST(LeftCornerParentsLookPastNullableSymbols)
+    {
+        std::vector<jhi::rule> rules;
+        rules.push_back(jhi::rule("$np", "$det", "$adj", "$noun"));
+        rules.push_back(jhi::rule("$np", "$adj", "$noun"));
+        rules.push_back(jhi::rule("$adj"));
+        rules.push_back(jhi::rule("$noun", "dog"));
+        jhi::grammar g(rules);
+
+        jhi::id_range parents = g.left_corner_parents(g.find("$noun"));
+        CHECK_EQUAL(1, parents.size());
+        CHECK_EQUAL(g.find("$np"), parents[0]);
+        CHECK_EQUAL(1, g.left_corner_parents(g.find("$adj")).size());
+        CHECK_EQUAL(0, g.left_corner_parents(g.find("$np")).size());
+        CHECK_EQUAL(g.find("$noun"), g.left_corner_parents(g.find("dog"))[0]);
+    }
+}
+
+SUITE(GrammarFileTests)
+{
+    char const* grammar_text =
+        "# test grammar\n"
+        "0.5\t$np --> $det $adj $adj $adj $noun\n"
+        "0.5\t$np --> $det $noun\n"
+        "\n"
+        "$det --> the\n"
+        "1 $adj --> big\n"
+        "1 $noun --> dog\n";
+
+    TEST(CanReadTextGrammar)
+    {
+        std::istringstream in(grammar_text);
+        jhi::grammar g(jhi::read_grammar(in));
+
+        CHECK_EQUAL(5, g.size());
+        CHECK_EQUAL(5, g.length(0));
+        CHECK_EQUAL(2, g.rules_with_head("$np").size());
+        CHECK_EQUAL(0.5, g.weight(1));
+        CHECK_EQUAL(1.0, g.weight(2));
+        CHECK_EQUAL("the", std::string(g.name(g.rhs(2).front())));
+        CHECK(g.terminal(g.find("dog")));
+        CHECK(!g.terminal(g.find("$noun")));
+        CHECK_EQUAL(-1, g.find("cat"));
+    }
+
+    TEST(MalformedLineThrows)
+    {
+        std::istringstream in("$np --> $det $noun\n$np $det\n");
+        CHECK_THROW(jhi::read_grammar(in), std::runtime_error);
+    }
+
+    TEST(SavedImageCanBeMapped)
+    {
+        std::istringstream in(grammar_text);
+        jhi::grammar g(jhi::read_grammar(in));
+        std::string path = "test_grammar.image";
+        {
+            std::ofstream out(path.c_str(), std::ios::binary);
+            g.save(out);
+        }
+
+        jhi::grammar m(jhi::load_grammar(path));
+        CHECK_EQUAL(g.size(), m.size());
+        CHECK_EQUAL(g.symbol_count(), m.symbol_count());
+        for(int r = 0; r < g.size(); ++r) {
+            CHECK_EQUAL(g.head(r), m.head(r));
+            CHECK_EQUAL(g.weight(r), m.weight(r));
+            CHECK(std::equal(g.rhs(r).begin(), g.rhs(r).end(), m.rhs(r).begin()));
+        }
+        CHECK_EQUAL(g.find("$adj"), m.find("$adj"));
+
+        std::vector<std::string> input;
+        input.push_back("the");
+        input.push_back("big");
+        input.push_back("big");
+        input.push_back("big");
+        input.push_back("dog");
+        CHECK_EQUAL(1, jhi::earley(m, "$np", input).size());
+        std::remove(path.c_str());
+    }
+
+    TEST(DamagedImagesAreRejected)
+    {
+        std::istringstream in(grammar_text);
+        std::ostringstream saved;
+        jhi::read_grammar(in).save(saved);
+        std::string image = saved.str();
+        //the header: magic, version, byte order, symbols, rules, then the
+        //offset and size of each section; the rules section is the fifth
+        boost::uint64_t rules_offset;
+        std::memcpy(&rules_offset, &image[24 + 16 * 4], 8);
+
+        std::vector<std::string> damaged;
+        damaged.push_back(image.substr(0, image.size() / 2));
+        damaged.push_back(image);
+        boost::int32_t far = 1 << 30;
+        std::memcpy(&damaged.back()[rules_offset + 4], &far, 4);   //a rule's rhs
+        damaged.push_back(image);
+        std::memcpy(&damaged.back()[rules_offset], &far, 4);       //a rule's head
+        damaged.push_back(image);
+        boost::int32_t negative = -5;
+        std::memcpy(&damaged.back()[rules_offset + 8], &negative, 4); //a rule's length
+
+        std::string path = "test_damaged.image";
+        for(int i = 0; i < damaged.size(); ++i) {
+            {
+                std::ofstream out(path.c_str(), std::ios::binary);
+                out.write(damaged[i].data(), damaged[i].size());
+            }
+            CHECK_THROW(jhi::grammar::map(path), std::runtime_error);
+        }
+        std::remove(path.c_str());
+    }
 }
@@ -0,0 +1,187 @@
+#include <UnitTest++.h>
+#include "inside_outside.h"
+
+#include <cmath>
+#include <limits>
+
+SUITE(InsideOutsideTests)
+{
+    struct ambiguous_fixture {
+        std::vector<jhi::rule> rules;
+        ambiguous_fixture() {
+            rules.push_back(jhi::rule("$np", "$np", "$noun"));
+            rules.push_back(jhi::rule("$np", "$noun", "$np"));
+            rules.push_back(jhi::rule("$np", "$noun"));
+            rules.push_back(jhi::rule("$noun", "apple"));
+            rules.push_back(jhi::rule("$noun", "worm"));
+            rules.push_back(jhi::rule("$noun", "gate"));
+        }
+    };
+
+    TEST(InsideProbabilityOfUnambiguousSentenceIsProductOfRuleWeights)
+    {
+        std::vector<jhi::rule> rules;
+        rules.push_back(jhi::rule("$simple", "$left", "$right"));
+        rules.push_back(jhi::rule("$left", "Hello"));
+        rules.push_back(jhi::rule("$left", "Goodbye"));
+        rules.push_back(jhi::rule("$right", "World"));
+        jhi::grammar g(rules);
+
+        std::vector<std::string> input;
+        input.push_back("Hello");
+        input.push_back("World");
+
+        jhi::rule_weights counts(g.size(), 0.0);
+        double p = jhi::inside_outside(g, jhi::uniform_weights(g), "$simple", input, counts);
+        CHECK_CLOSE(std::log(0.5), p, 1e-12);
+        CHECK_CLOSE(1.0, counts[0], 1e-12);
+        CHECK_CLOSE(1.0, counts[1], 1e-12);
+        CHECK_CLOSE(0.0, counts[2], 1e-12);
+        CHECK_CLOSE(1.0, counts[3], 1e-12);
+    }
+
+    TEST_FIXTURE(ambiguous_fixture, InsideProbabilitySumsOverAllParses)
+    {
+        jhi::grammar g(rules);
+        std::vector<std::string> input;
+        input.push_back("apple");
+        input.push_back("worm");
+        input.push_back("gate");
+
+        jhi::rule_weights counts(g.size(), 0.0);
+        double p = jhi::inside_outside(g, jhi::uniform_weights(g), "$np", input, counts);
+        //4 parses, each using 3 $np rules and 3 $noun rules
+        CHECK_CLOSE(std::log(4.0 / 729.0), p, 1e-12);
+        CHECK_CLOSE(3.0, counts[0] + counts[1] + counts[2], 1e-9);
+        CHECK_CLOSE(1.0, counts[2], 1e-9);
+        CHECK_CLOSE(1.0, counts[4], 1e-9);
+    }
+
+    TEST(UnparsableSentenceLeavesCountsUnchanged)
+    {
+        jhi::grammar g(jhi::get_default_rules());
+        std::vector<std::string> input;
+        input.push_back("the");
+        input.push_back("boy");
+
+        jhi::rule_weights counts(g.size(), 0.0);
+        CHECK_EQUAL(-std::numeric_limits<double>::infinity(),
+                jhi::inside_outside(g, jhi::uniform_weights(g), "$sentence", input, counts));
+        for(int i = 0; i < counts.size(); ++i)
+            CHECK_EQUAL(0.0, counts[i]);
+    }
+
+    TEST_FIXTURE(ambiguous_fixture, EmTrainingWithThreadsMatchesSingleThread)
+    {
+        jhi::grammar g(rules);
+        jhi::sentence_vector corpus;
+        const char* words[] = { "apple", "worm", "gate" };
+        for(int i = 0; i < 200; ++i) {
+            std::vector<std::string> s;
+            for(int k = 0; k <= i % 4; ++k)
+                s.push_back(words[(i + k) % 3]);
+            corpus.push_back(s);
+        }
+
+        jhi::rule_weights w1(jhi::uniform_weights(g)), w4(w1);
+        jhi::em_trainer one(g, "$np"), four(g, "$np", 4);
+        double prev = one.iterate(corpus, w1);
+        four.iterate(corpus, w4);
+        for(int it = 0; it < 3; ++it) {
+            double ll = one.iterate(corpus, w1);
+            CHECK(ll >= prev - 1e-9);
+            prev = ll;
+            four.iterate(corpus, w4);
+        }
+        for(int r = 0; r < g.size(); ++r)
+            CHECK_CLOSE(w1[r], w4[r], 1e-9);
+        CHECK_CLOSE(1.0, w1[0] + w1[1] + w1[2], 1e-9);
+    }
+
+    TEST_FIXTURE(ambiguous_fixture, EmTrainingCountsUnparsedSentences)
+    {
+        jhi::grammar g(rules);
+        jhi::sentence_vector corpus(4, std::vector<std::string>(2, "apple"));
+        corpus[1][1] = "pear";
+        corpus[3].clear();
+
+        jhi::rule_weights w(jhi::uniform_weights(g));
+        int unparsed = -1;
+        double ll = jhi::em_trainer(g, "$np", 2).iterate(corpus, w, &unparsed);
+        CHECK_EQUAL(2, unparsed);
+        //two parses of "apple apple", each using 2 $np rules and 2 $noun rules
+        CHECK_CLOSE(2 * std::log(2.0 / 81.0), ll, 1e-9);
+    }
+
+    TEST(LongSentencesDoNotUnderflow)
+    {
+        std::vector<jhi::rule> rules;
+        rules.push_back(jhi::rule("$list", "$item", "$list"));
+        rules.push_back(jhi::rule("$list", "$item"));
+        rules.push_back(jhi::rule("$item", "x"));
+        rules.push_back(jhi::rule("$item", "y"));
+        rules.push_back(jhi::rule("$item", "z"));
+        jhi::grammar g(rules);
+
+        //the probability is 6^-2000, far below the smallest double
+        std::vector<std::string> input(2000, "x");
+        jhi::rule_weights counts(g.size(), 0.0);
+        double p = jhi::inside_outside(g, jhi::uniform_weights(g), "$list", input, counts);
+        CHECK_CLOSE(-2000 * std::log(6.0), p, 1e-6);
+        CHECK_CLOSE(1999.0, counts[0], 1e-6);
+        CHECK_CLOSE(1.0, counts[1], 1e-6);
+        CHECK_CLOSE(2000.0, counts[2], 1e-6);
+        CHECK_CLOSE(0.0, counts[3], 1e-6);
+    }
+
+    TEST(ExpectedCountsIncludeEmptyConstituents)
+    {
+        std::vector<jhi::rule> rules;
+        rules.push_back(jhi::rule("$np", "$det", "$adj", "$noun"));
+        rules.push_back(jhi::rule("$adj"));
+        rules.push_back(jhi::rule("$adj", "big"));
+        rules.push_back(jhi::rule("$det", "the"));
+        rules.push_back(jhi::rule("$noun", "dog"));
+        jhi::grammar g(rules);
+
+        std::vector<std::string> input;
+        input.push_back("the");
+        input.push_back("dog");
+        jhi::rule_weights counts(g.size(), 0.0);
+        CHECK_CLOSE(std::log(0.5), jhi::inside_outside(g, jhi::uniform_weights(g), "$np", input, counts), 1e-12);
+        CHECK_CLOSE(1.0, counts[1], 1e-12);
+        CHECK_CLOSE(0.0, counts[2], 1e-12);
+    }
+
+    TEST(InsideProbabilityOfRightRecursiveList)
+    {
+        std::vector<jhi::rule> rules;
+        rules.push_back(jhi::rule("$list", "$item", "$list"));
+        rules.push_back(jhi::rule("$list", "$item"));
+        rules.push_back(jhi::rule("$item", "x"));
+        jhi::grammar g(rules);
+
+        std::vector<std::string> input(3, "x");
+        jhi::rule_weights counts(g.size(), 0.0);
+        CHECK_CLOSE(std::log(0.125), jhi::inside_outside(g, jhi::uniform_weights(g), "$list", input, counts), 1e-12);
+        CHECK_CLOSE(2.0, counts[0], 1e-12);
+        CHECK_CLOSE(3.0, counts[2], 1e-12);
+    }
+
+    TEST(UnaryCyclesKeepProbabilitiesFinite)
+    {
+        std::vector<jhi::rule> rules;
+        rules.push_back(jhi::rule("$a", "$b"));
+        rules.push_back(jhi::rule("$a", "x"));
+        rules.push_back(jhi::rule("$b", "$a"));
+        jhi::grammar g(rules);
+
+        jhi::rule_weights counts(g.size(), 0.0);
+        double z = std::exp(jhi::inside_outside(g, jhi::uniform_weights(g), "$a",
+                std::vector<std::string>(1, "x"), counts));
+        CHECK(z >= 0.5 && z < 1.0);
+        for(int r = 0; r < g.size(); ++r)
+            CHECK(counts[r] >= 0 && counts[r] < 10);
+        CHECK(counts[1] > 0.99);
+    }
+}
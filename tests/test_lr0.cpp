@@ -0,0 +1,104 @@
+#include <UnitTest++.h>
+#include "lr0.h"
+#include "chart.h"
+
+#include <sstream>
+
+namespace {
+
+    std::vector<std::string> words(char const* text) {
+        std::vector<std::string> ret;
+        std::istringstream in(text);
+        std::string w;
+        while (in >> w)
+            ret.push_back(w);
+        return ret;
+    }
+
+}//namespace
+
+SUITE(LR0Tests)
+{
+    TEST(AgreesWithDottedRuleRecognizer)
+    {
+        std::vector<jhi::rule> rules;
+        rules.push_back(jhi::rule("$s", "$np", "$vp"));
+        rules.push_back(jhi::rule("$np", "$np", "$pp"));
+        rules.push_back(jhi::rule("$np", "$det", "$noun"));
+        rules.push_back(jhi::rule("$np", "$det", "$adj", "$noun"));
+        rules.push_back(jhi::rule("$vp", "$verb", "$np"));
+        rules.push_back(jhi::rule("$vp", "$vp", "$pp"));
+        rules.push_back(jhi::rule("$pp", "$prep", "$np"));
+        rules.push_back(jhi::rule("$adj"));
+        rules.push_back(jhi::rule("$adj", "big"));
+        rules.push_back(jhi::rule("$det", "the"));
+        rules.push_back(jhi::rule("$noun", "dog"));
+        rules.push_back(jhi::rule("$noun", "park"));
+        rules.push_back(jhi::rule("$verb", "saw"));
+        rules.push_back(jhi::rule("$prep", "in"));
+        jhi::grammar g(rules);
+        jhi::lr0_automaton a(g, "$s");
+
+        char const* inputs[] = {
+            "the dog saw the dog",
+            "the big dog saw the dog in the park",
+            "the dog saw",
+            "the dog the dog",
+            "dog saw the dog",
+            "the dog saw the park in",
+            ""
+        };
+        for(int i = 0; i < 7; ++i) {
+            std::vector<std::string> input(words(inputs[i]));
+            bool expected = !jhi::goal_items(g, "$s", jhi::recognize(g, "$s", input)).empty();
+            CHECK_EQUAL(expected, jhi::accepted(a, jhi::lr0_recognize(g, a, input)));
+        }
+    }
+
+    TEST(MergesRulesWithCommonPrefixes)
+    {
+        std::vector<jhi::rule> rules;
+        char const* nouns[] = { "a", "b", "c", "d", "e", "f", "g", "h" };
+        for(int i = 0; i < 8; ++i)
+            rules.push_back(jhi::rule("$np", "$det", "$noun", nouns[i]));
+        rules.push_back(jhi::rule("$det", "the"));
+        rules.push_back(jhi::rule("$noun", "dog"));
+        jhi::grammar g(rules);
+        jhi::lr0_automaton a(g, "$np");
+
+        std::vector<std::string> input(words("the dog e"));
+        jhi::lr0_chart c = jhi::lr0_recognize(g, a, input);
+        CHECK(jhi::accepted(a, c));
+
+        //one item for all eight rules, one for the completed $det, one predicting $noun
+        jhi::chart dotted = jhi::recognize(g, "$np", input);
+        CHECK_EQUAL(3, c[1].size());
+        CHECK_EQUAL(10, dotted[1].size());
+    }
+
+    TEST(HandlesNullableAndCyclicRules)
+    {
+        std::vector<jhi::rule> rules;
+        rules.push_back(jhi::rule("$s", "$a", "$s", "$b"));
+        rules.push_back(jhi::rule("$s", "$s"));
+        rules.push_back(jhi::rule("$s", "x"));
+        rules.push_back(jhi::rule("$a"));
+        rules.push_back(jhi::rule("$a", "y"));
+        rules.push_back(jhi::rule("$b"));
+        jhi::grammar g(rules);
+        jhi::lr0_automaton a(g, "$s");
+
+        CHECK(jhi::accepted(a, jhi::lr0_recognize(g, a, words("x"))));
+        CHECK(jhi::accepted(a, jhi::lr0_recognize(g, a, words("y y x"))));
+        CHECK(!jhi::accepted(a, jhi::lr0_recognize(g, a, words("x y"))));
+        CHECK(!jhi::accepted(a, jhi::lr0_recognize(g, a, words(""))));
+    }
+
+    TEST(UnknownStartSymbolRecognizesNothing)
+    {
+        jhi::grammar g(jhi::get_default_rules());
+        jhi::lr0_automaton a(g, "$nothing");
+        CHECK_EQUAL(-1, a.start());
+        CHECK(!jhi::accepted(a, jhi::lr0_recognize(g, a, words("the boy"))));
+    }
+}
@@ -0,0 +1,118 @@
+#include <UnitTest++.h>
+#include "optimize.h"
+#include "chart.h"
+
+#include <sstream>
+
+SUITE(OptimizeTests)
+{
+    TEST(RemovesNonProductiveAndUnreachableRules)
+    {
+        std::vector<jhi::rule> rules;
+        rules.push_back(jhi::rule("$s", "$np", "$vp"));
+        rules.push_back(jhi::rule("$s", "$loop"));
+        rules.push_back(jhi::rule("$loop", "$loop", "x"));
+        rules.push_back(jhi::rule("$np", "dog"));
+        rules.push_back(jhi::rule("$vp", "barks"));
+        rules.push_back(jhi::rule("$adj", "big"));
+        jhi::grammar g(rules);
+
+        jhi::grammar_report report;
+        jhi::grammar o = jhi::optimize_grammar(g, "$s", false, &report);
+        CHECK_EQUAL(3, o.size());
+        CHECK_EQUAL(2, report.nonproductive.size());
+        CHECK_EQUAL(1, report.unreachable.size());
+        CHECK_EQUAL(5, report.unreachable[0]);
+        CHECK_EQUAL(-1, o.find("$loop"));
+        CHECK_EQUAL(-1, o.find("big"));
+    }
+
+    TEST(MergesDuplicateRulesAddingWeights)
+    {
+        jhi::grammar_builder b;
+        b.add(jhi::rule("$s", "x"), 0.25);
+        b.add(jhi::rule("$s", "y"), 0.5);
+        b.add(jhi::rule("$s", "x"), 0.25);
+        jhi::grammar_report report;
+        jhi::grammar o = jhi::optimize_grammar(b.build(), "$s", false, &report);
+        CHECK_EQUAL(2, o.size());
+        CHECK_EQUAL(1, report.duplicates.size());
+        CHECK_CLOSE(0.5, o.weight(0), 1e-12);
+    }
+
+    TEST(LeftFactoringKeepsLanguageAndWeights)
+    {
+        jhi::grammar_builder b;
+        b.add(jhi::rule("$np", "$det", "$noun"), 0.5);
+        b.add(jhi::rule("$np", "$det", "$adj", "$noun"), 0.25);
+        b.add(jhi::rule("$np", "$det"), 0.25);
+        b.add(jhi::rule("$det", "the"));
+        b.add(jhi::rule("$adj", "big"));
+        b.add(jhi::rule("$noun", "dog"));
+        jhi::grammar_report report;
+        jhi::grammar o = jhi::optimize_grammar(b.build(), "$np", true, &report);
+
+        CHECK_EQUAL(1, report.factored.size());
+        CHECK_EQUAL("$np|$det", report.factored[0]);
+        jhi::id_range np = o.rules_with_head("$np");
+        CHECK_EQUAL(1, np.size());
+        CHECK_CLOSE(1.0, o.weight(np[0]), 1e-12);
+        CHECK_EQUAL(3, o.rules_with_head("$np|$det").size());
+
+        char const* inputs[][3] = { { "the", "dog", 0 }, { "the", "big", "dog" }, { "the", 0, 0 } };
+        for(int i = 0; i < 3; ++i) {
+            std::vector<std::string> input;
+            for(int k = 0; k < 3 && inputs[i][k]; ++k)
+                input.push_back(inputs[i][k]);
+            CHECK_EQUAL(1, jhi::earley(o, "$np", input).size());
+        }
+    }
+
+    TEST(FactoredGrammarSurvivesWritingAndReading)
+    {
+        jhi::grammar_builder b;
+        b.add(jhi::rule("$np", "$det", "$adj", "$noun"), 0.5);
+        b.add(jhi::rule("$np", "$det", "$adj", "$adj"), 0.25);
+        b.add(jhi::rule("$np", "$det", "$noun"), 0.25);
+        b.add(jhi::rule("$det", "the"));
+        b.add(jhi::rule("$adj", "big"));
+        b.add(jhi::rule("$noun", "dog"));
+        jhi::grammar_report report;
+        jhi::grammar o = jhi::optimize_grammar(b.build(), "$np", true, &report);
+        CHECK_EQUAL(2, report.factored.size());
+        CHECK_EQUAL("$np|$det|$adj", report.factored[1]);
+
+        std::stringstream text;
+        text.precision(17);
+        for(int r = 0; r < o.size(); ++r) {
+            text << o.weight(r) << "\t";
+            o.write_rule(text, r);
+            text << "\n";
+        }
+        jhi::grammar read = jhi::read_grammar(text);
+        CHECK_EQUAL(o.size(), read.size());
+        for(int r = 0; r < o.size() && r < read.size(); ++r) {
+            CHECK_EQUAL(o.name(o.head(r)), read.name(read.head(r)));
+            CHECK_EQUAL(o.length(r), read.length(r));
+            CHECK_CLOSE(o.weight(r), read.weight(r), 1e-12);
+        }
+
+        char const* inputs[][4] = { { "the", "dog", 0, 0 }, { "the", "big", "dog", 0 },
+            { "the", "big", "big", 0 } };
+        for(int i = 0; i < 3; ++i) {
+            std::vector<std::string> input;
+            for(int k = 0; k < 4 && inputs[i][k]; ++k)
+                input.push_back(inputs[i][k]);
+            jhi::constituent_vector before = jhi::earley(o, "$np", input);
+            jhi::constituent_vector after = jhi::earley(read, "$np", input);
+            CHECK_EQUAL(1, before.size());
+            CHECK_EQUAL(before.size(), after.size());
+            for(int k = 0; k < before.size() && k < after.size(); ++k) {
+                std::ostringstream x, y;
+                jhi::print_constituent(x, before[k]);
+                jhi::print_constituent(y, after[k]);
+                CHECK_EQUAL(x.str(), y.str());
+            }
+        }
+    }
+}
@@ -25,4 +25,34 @@ SUITE(RuleTests)
     {
         CHECK(jhi::rule("$np", "$np", "$noun") == jhi::rule("$np", "$np", "$noun"));
     }
+
+    TEST(RuleCanHaveAnyNumberOfChildren)
+    {
+        char const* children[] = { "$det", "$adj", "$adj", "$adj", "$adj", "$noun" };
+        jhi::rule r("$np", std::vector<std::string>(children, children + 6));
+        CHECK_EQUAL(6, r.rhs().size());
+        CHECK_EQUAL("$noun", r.rhs().back());
+        CHECK(r == jhi::rule("$np", r.rhs()));
+    }
+
+    TEST(RulesWithDifferentLengthsAreNotEqual)
+    {
+        CHECK(!(jhi::rule("$np", "$det", "$noun") == jhi::rule("$np", "$det", "$noun", "$pp")));
+        CHECK(!(jhi::rule("$np", "$det", "$noun", "$pp") == jhi::rule("$np", "$det", "$noun")));
+    }
+
+    TEST(GrammarReturnsRulesAsAdded)
+    {
+        std::vector<std::string> children(12, "$x");
+        std::vector<jhi::rule> rules;
+        rules.push_back(jhi::rule("$long", children));
+        rules.push_back(jhi::rule("$x", "x"));
+        jhi::grammar g(rules);
+        CHECK(g[0] == rules[0]);
+        CHECK(g[1] == rules[1]);
+        CHECK_EQUAL(12, g.length(0));
+
+        std::vector<std::string> input(12, "x");
+        CHECK_EQUAL(1, jhi::earley(g, "$long", input).size());
+    }
 }
@@ -0,0 +1,119 @@
+#include <UnitTest++.h>
+#include "tokenizer.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+namespace {
+    std::vector<std::vector<std::string> > split(char const* text, jhi::tokenizer_mode mode = jhi::split_text) {
+        jhi::tokenizer t(text, text + std::strlen(text), mode);
+        std::vector<std::vector<std::string> > ret;
+        std::vector<jhi::token> sentence;
+        while (t.next(sentence)) {
+            ret.push_back(std::vector<std::string>());
+            for(int i = 0; i < sentence.size(); ++i)
+                ret.back().push_back(sentence[i].str());
+        }
+        return ret;
+    }
+}
+
+SUITE(TokenizerTests)
+{
+    TEST(SplitsWordsAndPunctuation)
+    {
+        std::vector<std::vector<std::string> > s(split("The boy's well-known dog, aged 3.5, barks..."));
+        CHECK_EQUAL(1, s.size());
+        char const* expected[] = { "The", "boy's", "well-known", "dog", ",", "aged", "3.5", ",", "barks", "..." };
+        CHECK_EQUAL(10, s[0].size());
+        for(int i = 0; i < 10 && i < s[0].size(); ++i)
+            CHECK_EQUAL(expected[i], s[0][i]);
+    }
+
+    TEST(SplitsSentences)
+    {
+        std::vector<std::vector<std::string> > s(split(
+                    "The boy hits the dog. \"Why?\" asked the rod.\n"
+                    "It was 3 p.m. on a sunny day\n\nA new paragraph"));
+        CHECK_EQUAL(4, s.size());
+        CHECK_EQUAL(6, s[0].size());
+        CHECK_EQUAL(".", s[0][5]);
+        //the question mark is followed by a lower-case word
+        CHECK_EQUAL(8, s[1].size());
+        CHECK_EQUAL("\"", s[1][3]);
+        CHECK_EQUAL(9, s[2].size());
+        CHECK_EQUAL("p.m", s[2][3]);
+        CHECK_EQUAL(3, s[3].size());
+    }
+
+    TEST(TokensAreViewsOfTheText)
+    {
+        char const* text = "  the boy\nhits the dog  \n\n\nrod \n";
+        jhi::tokenizer t(text, text + std::strlen(text), jhi::split_lines);
+        std::vector<jhi::token> sentence;
+        CHECK(t.next(sentence));
+        CHECK_EQUAL(2, sentence.size());
+        CHECK(sentence[0].text == text + 2);
+        CHECK_EQUAL(3, sentence[1].length);
+        CHECK(t.next(sentence));
+        CHECK_EQUAL(3, sentence.size());
+        CHECK(t.next(sentence));
+        CHECK_EQUAL(1, sentence.size());
+        CHECK(!t.next(sentence));
+        CHECK(sentence.empty());
+        CHECK(t.position() == text + std::strlen(text));
+    }
+
+    TEST(TokenizesMappedFiles)
+    {
+        std::string path = "test_tokenizer.txt";
+        {
+            std::ofstream out(path.c_str(), std::ios::binary);
+            out << "The boy hits the dog. The dog hits the boy.";
+        }
+        jhi::text_file f(path);
+        jhi::tokenizer t(f.begin(), f.end());
+        std::vector<jhi::token> sentence;
+        int sentences = 0;
+        while (t.next(sentence))
+            ++sentences;
+        CHECK_EQUAL(2, sentences);
+
+        {
+            std::ofstream out(path.c_str(), std::ios::binary);
+        }
+        jhi::text_file empty(path);
+        CHECK_EQUAL(0, empty.size());
+        std::remove(path.c_str());
+        CHECK_THROW(jhi::text_file("no such file"), std::runtime_error);
+    }
+
+    TEST(CorpusSentencesCanBeReadInAnyOrder)
+    {
+        char const* text =
+            "The boy (aged 3.5) hits the dog. \"Why?\" asked the rod.\n"
+            "It was 3 p.m. on a sunny day\n\nA new paragraph! Fin";
+        std::string path = "test_corpus.txt";
+        {
+            std::ofstream out(path.c_str(), std::ios::binary);
+            out << text;
+        }
+        std::vector<std::vector<std::string> > expected(split(text));
+        jhi::corpus c(path, jhi::split_text);
+        CHECK_EQUAL(expected.size(), c.size());
+        std::vector<jhi::token> sentence;
+        for(int i = c.size() - 1; i >= 0; --i) {
+            c.sentence(i, sentence);
+            CHECK_EQUAL(expected[i].size(), sentence.size());
+            for(int k = 0; k < sentence.size() && k < expected[i].size(); ++k)
+                CHECK_EQUAL(expected[i][k], sentence[k].str());
+        }
+
+        jhi::corpus lines(path, jhi::pretokenized);
+        CHECK_EQUAL(3, lines.size());
+        lines.sentence(0, sentence);
+        CHECK_EQUAL("(aged", sentence[2].str());
+        std::remove(path.c_str());
+    }
+}
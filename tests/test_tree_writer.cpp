@@ -0,0 +1,137 @@
+#include <UnitTest++.h>
+#include "tree_writer.h"
+#include "treebank.h"
+
+#include <sstream>
+
+namespace {
+    std::vector<jhi::token> tokens(std::vector<std::string> const& words) {
+        std::vector<jhi::token> ret;
+        for(int i = 0; i < words.size(); ++i)
+            ret.push_back(jhi::token(words[i]));
+        return ret;
+    }
+
+    std::vector<std::string> sentence() {
+        std::vector<std::string> input;
+        input.push_back("the");
+        input.push_back("boy");
+        input.push_back("hits");
+        input.push_back("the");
+        input.push_back("dog");
+        return input;
+    }
+
+    std::string write(jhi::tree_format format, std::vector<std::string> const& input,
+            jhi::constituent_vector const& parses)
+    {
+        std::ostringstream out;
+        jhi::tree_writer w(out, format, 16);
+        std::vector<jhi::token> t(tokens(input));
+        w.begin_sentence(&t[0], t.size(), parses.size());
+        for(int i = 0; i < parses.size(); ++i)
+            w.write(*parses[i]);
+        w.end_sentence();
+        w.flush();
+        return out.str();
+    }
+}
+
+SUITE(TreeWriterTests)
+{
+    TEST(IndentedFormatMatchesPrintConstituent)
+    {
+        jhi::grammar g(jhi::get_default_rules());
+        std::vector<std::string> input(sentence());
+        jhi::constituent_vector parses = jhi::earley(g, "$sentence", input);
+        CHECK_EQUAL(1, parses.size());
+
+        std::ostringstream expected;
+        expected << "Input: the boy hits the dog \n# parses: 1\n";
+        jhi::print_constituent(expected, parses[0]);
+        CHECK_EQUAL(expected.str(), write(jhi::indented_format, input, parses));
+    }
+
+    TEST(PennTreesCanBeReadBack)
+    {
+        jhi::grammar g(jhi::get_default_rules());
+        std::vector<std::string> input(sentence());
+        std::string penn(write(jhi::penn_format, input, jhi::earley(g, "$sentence", input)));
+        CHECK_EQUAL("(sentence (np (det the) (noun boy)) (vp (verb hits) (np (det the) (noun dog))))\n\n", penn);
+
+        jhi::rule_count_map counts;
+        jhi::rule_extractor e(counts);
+        e.feed(penn.data(), penn.data() + penn.size());
+        CHECK_EQUAL(1, e.trees());
+        CHECK_EQUAL(2, counts["$np --> $det $noun"]);
+        CHECK_EQUAL(1, counts["$vp --> $verb $np"]);
+    }
+
+    TEST(PennFormatEscapesBrackets)
+    {
+        std::vector<jhi::rule> rules;
+        rules.push_back(jhi::rule("$s", "$open", "$w{1}", "$close"));
+        rules.push_back(jhi::rule("$open", "("));
+        rules.push_back(jhi::rule("$w{1}", "{a}"));
+        rules.push_back(jhi::rule("$close", ")"));
+        jhi::grammar g(rules);
+        std::vector<std::string> input;
+        input.push_back("(");
+        input.push_back("{a}");
+        input.push_back(")");
+        std::string penn(write(jhi::penn_format, input, jhi::earley(g, "$s", input)));
+        CHECK_EQUAL("(s (open -LRB-) (w-LCB-1-RCB- -LCB-a-RCB-) (close -RRB-))\n\n", penn);
+
+        jhi::rule_count_map counts;
+        jhi::rule_extractor e(counts);
+        e.feed(penn.data(), penn.data() + penn.size());
+        CHECK_EQUAL(1, e.trees());
+        CHECK_EQUAL(1, counts["$s --> $open $w-LCB-1-RCB- $close"]);
+        CHECK_EQUAL(1, counts["$open --> -LRB-"]);
+    }
+
+    TEST(JsonEscapesStrings)
+    {
+        std::vector<std::string> input(1, "say \"hi\"\\");
+        jhi::constituent_vector children(1, jhi::constituent_ptr(new jhi::constituent(0, 1, input[0])));
+        jhi::constituent_vector parses(1, jhi::constituent_ptr(new jhi::constituent(0, 1, "$quote", children)));
+        CHECK_EQUAL("{\"input\":[\"say \\\"hi\\\"\\\\\"],\"parses\":["
+                "{\"label\":\"quote\",\"start\":0,\"end\":1,\"children\":["
+                "{\"word\":\"say \\\"hi\\\"\\\\\",\"start\":0,\"end\":1}]}]}\n",
+                write(jhi::json_format, input, parses));
+        CHECK_EQUAL("{\"input\":[\"say \\\"hi\\\"\\\\\"],\"parses\":[]}\n",
+                write(jhi::json_format, input, jhi::constituent_vector()));
+    }
+
+    TEST(BinaryFormatHasFixedWidthFields)
+    {
+        std::vector<std::string> input(1, "x");
+        jhi::constituent_vector children(1, jhi::constituent_ptr(new jhi::constituent(0, 1, "x")));
+        jhi::constituent_vector parses(1, jhi::constituent_ptr(new jhi::constituent(0, 1, "$a", children)));
+        std::string out(write(jhi::binary_format, input, parses));
+        char const expected[] =
+            "\1\0\0\0" "\1\0\0\0x"                             //words
+            "\1\0\0\0"                                         //parses
+            "\0\0\0\0" "\1\0\0\0" "\1\0\0\0" "\2\0\0\0$a"      //($a
+            "\0\0\0\0" "\1\0\0\0" "\0\0\0\0" "\1\0\0\0x";      //  x)
+        CHECK_EQUAL(sizeof(expected) - 1, out.size());
+        CHECK(out == std::string(expected, sizeof(expected) - 1));
+    }
+
+    TEST(DeepTreesAreWrittenWithoutRecursion)
+    {
+        int const depth = 20000;
+        jhi::constituent_ptr t(new jhi::constituent(0, 1, "x"));
+        for(int i = 0; i < depth; ++i)
+            t = jhi::constituent_ptr(new jhi::constituent(0, 1, "$a", jhi::constituent_vector(1, t)));
+        std::string out(write(jhi::penn_format, std::vector<std::string>(1, "x"), jhi::constituent_vector(1, t)));
+        CHECK_EQUAL(depth * 4 + 1 + 2, out.size());
+        CHECK_EQUAL("(a (a", out.substr(0, 5));
+
+        //the nodes still have to be freed one at a time
+        while (!t->children().empty()) {
+            jhi::constituent_ptr child = t->children()[0];
+            t = child;
+        }
+    }
+}
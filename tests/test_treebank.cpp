@@ -0,0 +1,99 @@
+#include <UnitTest++.h>
+#include "treebank.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+SUITE(TreebankTests)
+{
+    TEST(ExtractsRulesOfAnyLength)
+    {
+        char const* tree =
+            "( (S (NP (DT the) (NN boy))\n"
+            "     (VP (VBZ hits) (NP (DT a) (JJ big) (JJ red) (NN dog)))) )\n";
+        jhi::rule_count_map counts;
+        jhi::rule_extractor e(counts);
+        e.feed(tree, tree + std::strlen(tree));
+
+        CHECK_EQUAL(1, e.trees());
+        CHECK(e.at_boundary());
+        CHECK_EQUAL(1, counts["$S --> $NP $VP"]);
+        CHECK_EQUAL(1, counts["$NP --> $DT $JJ $JJ $NN"]);
+        CHECK_EQUAL(2, counts["$DT --> the"] + counts["$DT --> a"]);
+        CHECK_EQUAL(11, counts.size());
+    }
+
+    TEST(InputMayBeSplitAnywhere)
+    {
+        std::string trees = "(S (NP (NN boy)) (VP (VBZ sleeps)))\n(S (NP (NN dog)) (VP (VBZ sleeps)))\n";
+        jhi::rule_count_map whole, pieces;
+        jhi::rule_extractor w(whole), p(pieces);
+        w.feed(trees.data(), trees.data() + trees.size());
+        for(int i = 0; i < trees.size(); ++i)
+            p.feed(trees.data() + i, trees.data() + i + 1);
+
+        CHECK_EQUAL(2, p.trees());
+        CHECK(whole == pieces);
+        CHECK_EQUAL(2, pieces["$VBZ --> sleeps"]);
+    }
+
+    TEST(DollarSignsAreEscaped)
+    {
+        char const* tree = "(S (NP (PRP$ his) (NN pay)) (VP (VBD was) (NP ($ $) (CD 5))))\n";
+        jhi::rule_count_map counts;
+        jhi::rule_extractor e(counts);
+        e.feed(tree, tree + std::strlen(tree));
+
+        CHECK_EQUAL(1, counts["$NP --> $PRP-DOL- $NN"]);
+        CHECK_EQUAL(1, counts["$PRP-DOL- --> his"]);
+        CHECK_EQUAL(1, counts["$NP --> $-DOL- $CD"]);
+        CHECK_EQUAL(1, counts["$-DOL- --> -DOL-"]);
+    }
+
+    TEST(MissingFilesAreReported)
+    {
+        jhi::rule_count_map counts;
+        CHECK_THROW(jhi::count_rules(std::vector<std::string>(1, "no/such/treebank.mrg"), 1, counts),
+                std::runtime_error);
+    }
+
+    TEST(ShardsEndBetweenUnindentedTrees)
+    {
+        //lines inside a tree may start with '(' too
+        std::string path = "test_treebank.mrg";
+        {
+            std::ofstream out(path.c_str(), std::ios::binary);
+            for(int i = 0; i < 1000; ++i)
+                out << "(S\n(NP (NN boy))\n(VP (VBZ sleeps)))\n";
+        }
+        for(int threads = 1; threads <= 3; ++threads) {
+            jhi::rule_count_map counts;
+            CHECK_EQUAL(2000, jhi::count_rules(std::vector<std::string>(2, path), threads, counts));
+            CHECK_EQUAL(2000, counts["$S --> $NP $VP"]);
+            CHECK_EQUAL(2000, counts["$NP --> $NN"]);
+            CHECK_EQUAL(5, counts.size());
+        }
+
+        //a file ending inside a tree
+        {
+            std::ofstream out(path.c_str(), std::ios::binary | std::ios::app);
+            out << "(S\n(NP (NN boy))\n";
+        }
+        jhi::rule_count_map counts;
+        CHECK_THROW(jhi::count_rules(std::vector<std::string>(1, path), 2, counts), std::runtime_error);
+        std::remove(path.c_str());
+    }
+
+    TEST(WritesRelativeFrequencies)
+    {
+        jhi::rule_count_map counts;
+        counts["$NP --> $DT $NN"] = 3;
+        counts["$NP --> $NN"] = 1;
+        std::ostringstream out;
+        jhi::write_grammar(out, counts);
+        CHECK_EQUAL("0.75\t$NP --> $DT $NN\n0.25\t$NP --> $NN\n", out.str());
+    }
+}